@@ -5,6 +5,289 @@
 #include <stdbool.h>
 
 #include <math.h>
+#include <stdint.h>
+#include <time.h>
+
+/* ==========================================
+   POD PHYSICS
+   ========================================== */
+
+// Deterministic replica of the referee's pod physics, one tick at a time:
+// rotate (at most 18 degrees, free on the very first tick), thrust along the
+// facing, move with checkpoint detection along the path, then friction and
+// the referee's truncation (velocity toward zero, position and angle rounded).
+// State is a handful of int16 fields so a search can copy and simulate
+// millions of ticks per second.
+
+#define MAP_WIDTH 16000
+#define MAP_HEIGHT 9000
+#define CHECKPOINT_RADIUS 600
+#define POD_RADIUS 400
+#define MAX_TURN 18.0
+#define FRICTION 0.85
+#define MAX_THRUST 100
+#define BOOST_THRUST 650
+#define SHIELD_COOLDOWN 3
+#define MAX_CHECKPOINTS 8
+#define DEFAULT_LAPS 3
+
+// Special thrust values
+#define THRUST_BOOST -1
+#define THRUST_SHIELD -2
+
+#define DEG_TO_RAD (3.14159265358979323846 / 180.0)
+
+typedef struct
+{
+	int count;
+	int laps;
+	int x[MAX_CHECKPOINTS];
+	int y[MAX_CHECKPOINTS];
+} Track;
+
+typedef struct
+{
+	int16_t x, y;
+	int16_t vx, vy;
+	int16_t angle;			 // facing in degrees [0, 360), -1 = not set yet
+	uint8_t next_checkpoint; // index into the track
+	uint8_t passed;			 // checkpoints taken so far, laps * count = finished
+	uint8_t boost_used;
+	uint8_t shield_cooldown; // ticks left without thrust after a SHIELD
+	uint8_t shield_active;	 // SHIELD fired this tick (mass x10 on impact)
+	uint8_t pad_;
+} Pod;
+
+static inline double normalize_angle(double a)
+{
+	a = fmod(a, 360.0);
+	return a < 0 ? a + 360.0 : a;
+}
+
+// Absolute direction from the pod to (x, y), degrees [0, 360)
+static inline double pod_angle_to(const Pod *pod, double x, double y)
+{
+	return normalize_angle(atan2(y - pod->y, x - pod->x) / DEG_TO_RAD);
+}
+
+// Signed turn from the facing to (x, y), in (-180, 180]
+static inline double pod_diff_angle(const Pod *pod, double x, double y)
+{
+	double d = pod_angle_to(pod, x, y) - (pod->angle < 0 ? 0 : pod->angle);
+	if (d > 180)
+		d -= 360;
+	else if (d <= -180)
+		d += 360;
+	return d;
+}
+
+static inline bool pod_finished(const Pod *pod, const Track *track)
+{
+	return pod->passed >= track->count * track->laps;
+}
+
+// Rotation and thrust for one tick. turn is clamped to +-MAX_TURN except on
+// the pod's first tick, when it may face anywhere. Returns the facing as a
+// double, kept unrounded until the end of the tick.
+static inline double pod_steer(Pod *pod, double turn, int thrust, double *vx, double *vy)
+{
+	double facing;
+	if (pod->angle < 0)
+		facing = normalize_angle(turn);
+	else
+	{
+		if (turn > MAX_TURN)
+			turn = MAX_TURN;
+		else if (turn < -MAX_TURN)
+			turn = -MAX_TURN;
+		facing = normalize_angle(pod->angle + turn);
+	}
+
+	pod->shield_active = 0;
+	if (thrust == THRUST_SHIELD)
+	{
+		pod->shield_active = 1;
+		pod->shield_cooldown = SHIELD_COOLDOWN;
+		thrust = 0;
+	}
+	else if (pod->shield_cooldown > 0)
+	{
+		pod->shield_cooldown--;
+		thrust = 0;
+	}
+	else if (thrust == THRUST_BOOST)
+	{
+		if (pod->boost_used)
+			thrust = MAX_THRUST;
+		else
+		{
+			pod->boost_used = 1;
+			thrust = BOOST_THRUST;
+		}
+	}
+	else if (thrust < 0)
+		thrust = 0;
+	else if (thrust > MAX_THRUST)
+		thrust = MAX_THRUST;
+
+	*vx = pod->vx + cos(facing * DEG_TO_RAD) * thrust;
+	*vy = pod->vy + sin(facing * DEG_TO_RAD) * thrust;
+	return facing;
+}
+
+// Earliest time in [0, 1] at which a point moving from (x, y) by (vx, vy)
+// comes within r of (cx, cy), or -1 if it never does this tick
+static inline double circle_hit_time(double x, double y, double vx, double vy, double cx, double cy, double r)
+{
+	double dx = x - cx, dy = y - cy;
+	double c = dx * dx + dy * dy - r * r;
+	if (c < 0)
+		return 0;
+	double a = vx * vx + vy * vy;
+	if (a == 0)
+		return -1;
+	double b = dx * vx + dy * vy;
+	double disc = b * b - a * c;
+	if (b >= 0 || disc < 0)
+		return -1;
+	double t = (-b - sqrt(disc)) / a;
+	return t <= 1.0 ? t : -1;
+}
+
+// Move (x, y) along the velocity for `span` of a tick, taking every
+// checkpoint crossed on the way (a fast pod can pass more than one)
+static inline void pod_travel(Pod *pod, const Track *track, double *x, double *y, double vx, double vy, double span)
+{
+	double t = 0;
+	for (int k = 0; k < track->count && !pod_finished(pod, track); ++k)
+	{
+		int cp = pod->next_checkpoint;
+		double sx = *x + vx * t, sy = *y + vy * t;
+		double hit = circle_hit_time(sx, sy, vx * (span - t), vy * (span - t), track->x[cp], track->y[cp], CHECKPOINT_RADIUS);
+		if (hit < 0)
+			break;
+		t += hit * (span - t);
+		pod->passed++;
+		pod->next_checkpoint = (cp + 1) % track->count;
+	}
+	*x += vx * span;
+	*y += vy * span;
+}
+
+// End of tick: friction and truncation
+static inline void pod_settle(Pod *pod, double facing, double x, double y, double vx, double vy)
+{
+	pod->x = (int16_t)floor(x + 0.5);
+	pod->y = (int16_t)floor(y + 0.5);
+	pod->vx = (int16_t)(vx * FRICTION);
+	pod->vy = (int16_t)(vy * FRICTION);
+	pod->angle = (int16_t)((int)floor(facing + 0.5) % 360);
+}
+
+static inline void pod_move(Pod *pod, const Track *track, double facing, double vx, double vy)
+{
+	double x = pod->x, y = pod->y;
+	pod_travel(pod, track, &x, &y, vx, vy, 1.0);
+	pod_settle(pod, facing, x, y, vx, vy);
+}
+
+// Time in [0, 1] at which two pods moving by (vx, vy) relative to each other
+// touch, or -1. Overlapping pods that are closing count as touching now.
+static inline double pod_collision_time(double dx, double dy, double vx, double vy)
+{
+	double r = 2 * POD_RADIUS;
+	if (dx * dx + dy * dy < r * r)
+		return dx * vx + dy * vy < 0 ? 0 : -1;
+	return circle_hit_time(dx, dy, vx, vy, 0, 0, r);
+}
+
+// The referee's elastic bounce: mass 1, or 10 behind a SHIELD, and at least
+// MIN_IMPULSE of push-back on top of the elastic exchange
+#define SHIELD_MASS 10.0
+#define MIN_IMPULSE 120.0
+
+static inline void pod_bounce(const Pod *a, const Pod *b, double dx, double dy, double *avx, double *avy, double *bvx, double *bvy)
+{
+	double ma = a->shield_active ? SHIELD_MASS : 1.0, mb = b->shield_active ? SHIELD_MASS : 1.0;
+	double mcoeff = (ma + mb) / (ma * mb);
+	double d2 = dx * dx + dy * dy;
+	if (d2 == 0)
+		return;
+	double product = dx * (*avx - *bvx) + dy * (*avy - *bvy);
+	double fx = dx * product / (d2 * mcoeff), fy = dy * product / (d2 * mcoeff);
+	*avx -= fx / ma;
+	*avy -= fy / ma;
+	*bvx += fx / mb;
+	*bvy += fy / mb;
+
+	double impulse = sqrt(fx * fx + fy * fy);
+	if (impulse > 0 && impulse < MIN_IMPULSE)
+	{
+		fx *= MIN_IMPULSE / impulse;
+		fy *= MIN_IMPULSE / impulse;
+	}
+	*avx -= fx / ma;
+	*avy -= fy / ma;
+	*bvx += fx / mb;
+	*bvy += fy / mb;
+}
+
+// One full tick for a lone pod: turn by `turn` degrees, apply thrust
+// (0..100, THRUST_BOOST or THRUST_SHIELD), move
+static inline void pod_step(Pod *pod, const Track *track, double turn, int thrust)
+{
+	double vx, vy;
+	double facing = pod_steer(pod, turn, thrust, &vx, &vy);
+	pod_move(pod, track, facing, vx, vy);
+}
+
+// One tick for two pods that may collide: both steer, then move together,
+// bouncing at each contact within the tick. Each pod takes checkpoints on
+// its own track.
+static inline void pods_step(Pod *a, const Track *ta, double a_turn, int a_thrust,
+							 Pod *b, const Track *tb, double b_turn, int b_thrust)
+{
+	double avx, avy, bvx, bvy;
+	double af = pod_steer(a, a_turn, a_thrust, &avx, &avy);
+	double bf = pod_steer(b, b_turn, b_thrust, &bvx, &bvy);
+	double ax = a->x, ay = a->y, bx = b->x, by = b->y;
+	double t = 0;
+	for (int k = 0; k < 4 && t < 1.0; ++k)
+	{
+		double left = 1.0 - t;
+		double hit = pod_collision_time(ax - bx, ay - by, (avx - bvx) * left, (avy - bvy) * left);
+		if (hit < 0)
+			break;
+		pod_travel(a, ta, &ax, &ay, avx, avy, hit * left);
+		pod_travel(b, tb, &bx, &by, bvx, bvy, hit * left);
+		pod_bounce(a, b, ax - bx, ay - by, &avx, &avy, &bvx, &bvy);
+		t += hit * left;
+	}
+	pod_travel(a, ta, &ax, &ay, avx, avy, 1.0 - t);
+	pod_travel(b, tb, &bx, &by, bvx, bvy, 1.0 - t);
+	pod_settle(a, af, ax, ay, avx, avy);
+	pod_settle(b, bf, bx, by, bvx, bvy);
+}
+
+// Cheap test before pods_step: can the two pods touch this tick given
+// their speeds and the largest thrusts they might apply
+static inline bool pods_may_touch(const Pod *a, const Pod *b, int a_push, int b_push)
+{
+	double reach = 2 * POD_RADIUS + abs(a->vx) + abs(a->vy) + abs(b->vx) + abs(b->vy) + a_push + b_push;
+	double dx = a->x - b->x, dy = a->y - b->y;
+	return dx * dx + dy * dy < reach * reach;
+}
+
+// Tick aimed at a point, the way the game's "x y thrust" output is applied
+static inline void pod_step_towards(Pod *pod, const Track *track, int tx, int ty, int thrust)
+{
+	double turn = pod->angle < 0 ? pod_angle_to(pod, tx, ty) : pod_diff_angle(pod, tx, ty);
+	pod_step(pod, track, turn, thrust);
+}
+
+/* ==========================================
+   THRUST HEURISTIC
+   ========================================== */
 
 int calculate_thrust(int angle, int previous_thrust)
 {
@@ -52,15 +335,741 @@ int calculate_thrust(int angle, int previous_thrust)
 	return thrust;
 }
 
+// The original controller's decision for one tick: thrust from the angle
+// bands, BOOST on a long aligned straight, easing off near the checkpoint.
+// previous_thrust carries the band thrust between ticks.
+static inline int heuristic_decide(int next_checkpoint_dist, int next_checkpoint_angle, int *previous_thrust)
+{
+	*previous_thrust = calculate_thrust(next_checkpoint_angle, *previous_thrust);
+	if (next_checkpoint_dist < 10000 && next_checkpoint_dist > 3000 && abs(next_checkpoint_angle) < 40)
+		return THRUST_BOOST;
+	if (next_checkpoint_dist < 2500)
+		return abs(*previous_thrust - 20);
+	return *previous_thrust;
+}
+
+/* ==========================================
+   STATE TRACKER
+   ========================================== */
+
+// The input is positions and the next checkpoint only. The tracker keeps
+// what follows from them across ticks: both pods' velocities (the referee
+// keeps 0.85 of the last move, truncated), our facing, and the checkpoint
+// list, learned in order during lap 1 and complete once the first one comes
+// round again. A complete course also gets per-checkpoint entry angles and
+// leg lengths, so the search can plan through a checkpoint towards the next.
+
+typedef struct
+{
+	Track track;
+	bool complete;
+	double entry_angle[MAX_CHECKPOINTS]; // heading that takes checkpoint i and points on to i + 1
+	double leg_length[MAX_CHECKPOINTS];	 // from checkpoint i - 1 to i
+	int longest_leg;					 // checkpoint ending the longest leg, where BOOST pays most
+} Course;
+
+typedef struct
+{
+	Course course;
+	Pod me;
+	Pod opponent;
+	int ticks;
+} Tracker;
+
+static inline int course_find(const Course *course, int x, int y)
+{
+	for (int i = 0; i < course->track.count; ++i)
+		if (course->track.x[i] == x && course->track.y[i] == y)
+			return i;
+	return -1;
+}
+
+static inline void course_add(Course *course, int x, int y)
+{
+	Track *track = &course->track;
+	if (track->count < MAX_CHECKPOINTS)
+	{
+		track->x[track->count] = x;
+		track->y[track->count] = y;
+		track->count++;
+	}
+}
+
+// The whole lap is known: entry angle is the bisector of the incoming and
+// outgoing legs
+static inline void course_finish(Course *course)
+{
+	const Track *track = &course->track;
+	int n = track->count;
+	course->complete = true;
+	course->longest_leg = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		int prev = (i + n - 1) % n, next = (i + 1) % n;
+		double ix = track->x[i] - track->x[prev], iy = track->y[i] - track->y[prev];
+		double ox = track->x[next] - track->x[i], oy = track->y[next] - track->y[i];
+		double il = sqrt(ix * ix + iy * iy), ol = sqrt(ox * ox + oy * oy);
+		course->leg_length[i] = il;
+		course->entry_angle[i] = normalize_angle(atan2(iy / (il > 0 ? il : 1) + oy / (ol > 0 ? ol : 1),
+													   ix / (il > 0 ? il : 1) + ox / (ol > 0 ? ol : 1)) /
+												 DEG_TO_RAD);
+		if (il > course->leg_length[course->longest_leg])
+			course->longest_leg = i;
+	}
+}
+
+// Velocity that produced the move from the stored position, after friction
+static inline void tracker_velocity(Pod *pod, int x, int y)
+{
+	pod->vx = (int16_t)((x - pod->x) * FRICTION);
+	pod->vy = (int16_t)((y - pod->y) * FRICTION);
+	pod->x = (int16_t)x;
+	pod->y = (int16_t)y;
+}
+
+static inline void tracker_update(Tracker *t, int x, int y, int cp_x, int cp_y, int cp_angle, int opponent_x, int opponent_y)
+{
+	Course *course = &t->course;
+	Track *track = &course->track;
+	if (t->ticks == 0)
+	{
+		memset(t, 0, sizeof(*t));
+		track->laps = DEFAULT_LAPS;
+		course_add(course, cp_x, cp_y);
+		t->me.x = (int16_t)x;
+		t->me.y = (int16_t)y;
+		t->opponent.x = (int16_t)opponent_x;
+		t->opponent.y = (int16_t)opponent_y;
+		t->opponent.angle = -1;
+	}
+	else if (track->x[t->me.next_checkpoint] != cp_x || track->y[t->me.next_checkpoint] != cp_y)
+	{
+		// Checkpoint taken; back at the first one means the lap is known
+		t->me.passed++;
+		int index = course_find(course, cp_x, cp_y);
+		if (index < 0 && !course->complete)
+		{
+			course_add(course, cp_x, cp_y);
+			index = track->count - 1;
+		}
+		else if (index == 0 && !course->complete)
+			course_finish(course);
+		t->me.next_checkpoint = (uint8_t)(index < 0 ? 0 : index);
+	}
+
+	Pod *op = &t->opponent;
+	if (t->ticks > 0)
+	{
+		// The opponent is on the same checkpoint list; credit it when its
+		// last move crossed the checkpoint it was heading for
+		double mx = opponent_x - op->x, my = opponent_y - op->y;
+		int cp = op->next_checkpoint;
+		if ((cp + 1 < track->count || course->complete) &&
+			circle_hit_time(op->x, op->y, mx, my, track->x[cp], track->y[cp], CHECKPOINT_RADIUS) >= 0)
+		{
+			op->passed++;
+			op->next_checkpoint = (uint8_t)((cp + 1) % track->count);
+		}
+		tracker_velocity(&t->me, x, y);
+		tracker_velocity(op, opponent_x, opponent_y);
+		if (op->vx != 0 || op->vy != 0)
+			op->angle = (int16_t)normalize_angle(floor(atan2(op->vy, op->vx) / DEG_TO_RAD + 0.5));
+	}
+
+	// Facing from the checkpoint angle
+	t->me.angle = (int16_t)normalize_angle(floor(pod_angle_to(&t->me, cp_x, cp_y) - cp_angle + 0.5));
+	t->ticks++;
+}
+
+// Record what we sent this tick: BOOST is spent, SHIELD starts its cooldown
+static inline void tracker_commit(Tracker *t, int thrust)
+{
+	if (thrust == THRUST_SHIELD)
+		t->me.shield_cooldown = SHIELD_COOLDOWN;
+	else if (t->me.shield_cooldown > 0)
+		t->me.shield_cooldown--;
+	else if (thrust == THRUST_BOOST)
+		t->me.boost_used = 1;
+}
+
+// What the search plans against: the full course once known, otherwise just
+// the next checkpoint
+static inline const Course *tracker_view(const Tracker *t, Course *scratch, Pod *pod)
+{
+	*pod = t->me;
+	if (t->course.complete)
+		return &t->course;
+	memset(scratch, 0, sizeof(*scratch));
+	scratch->track.count = 1;
+	scratch->track.laps = DEFAULT_LAPS;
+	scratch->track.x[0] = t->course.track.x[t->me.next_checkpoint];
+	scratch->track.y[0] = t->course.track.y[t->me.next_checkpoint];
+	pod->next_checkpoint = 0;
+	pod->passed = 0;
+	return scratch;
+}
+
+/* ==========================================
+   OPPONENT MODEL
+   ========================================== */
+
+// The opponent is assumed to race: steer straight at its next checkpoint at
+// full thrust. Its trajectory over the search horizon is predicted once per
+// tick and shared by every plan; a plan only simulates the opponent itself
+// from the first tick the two pods can touch.
+//
+// With one pod each, blocking only pays once the race itself is lost: when
+// the opponent leads by INTERCEPT_LEAD checkpoints and we are nearer its next
+// checkpoint than it is, plans are scored on holding the opponent back
+// instead of on our own progress.
+
+#ifndef PREDICT_DEPTH
+#define PREDICT_DEPTH 8
+#endif
+#define INTERCEPT_LEAD 2
+
+typedef struct
+{
+	Pod path[PREDICT_DEPTH + 1]; // state at the start of each tick
+	const Track *track;			 // the learned checkpoints, possibly partial
+	bool present;
+	bool intercept;
+} Opponent;
+
+static inline void opponent_action(const Pod *op, const Track *track, double *turn, int *thrust)
+{
+	int cp = op->next_checkpoint;
+	*turn = op->angle < 0 ? pod_angle_to(op, track->x[cp], track->y[cp]) : pod_diff_angle(op, track->x[cp], track->y[cp]);
+	*thrust = MAX_THRUST;
+}
+
+static inline void opponent_predict(Opponent *o, const Tracker *t)
+{
+	const Track *track = &t->course.track;
+	o->track = track;
+	o->present = t->ticks > 0;
+	o->path[0] = t->opponent;
+	for (int i = 0; i < PREDICT_DEPTH; ++i)
+	{
+		double turn;
+		int thrust;
+		o->path[i + 1] = o->path[i];
+		opponent_action(&o->path[i], track, &turn, &thrust);
+		pod_step(&o->path[i + 1], track, turn, thrust);
+	}
+
+	const Pod *me = &t->me, *op = &t->opponent;
+	int cp = op->next_checkpoint;
+	double mx = track->x[cp] - me->x, my = track->y[cp] - me->y;
+	double ox = track->x[cp] - op->x, oy = track->y[cp] - op->y;
+	o->intercept = t->course.complete && op->passed >= me->passed + INTERCEPT_LEAD &&
+				   mx * mx + my * my < ox * ox + oy * oy;
+}
+
+/* ==========================================
+   SEARCH CONTROLLER
+   ========================================== */
+
+// Rolling-horizon evolution: a small population of SEARCH_DEPTH-tick plans
+// (turn, thrust) is mutated and re-scored on the physics engine until the
+// tick's time budget runs out. Each tick starts from the previous best plan
+// shifted by one, plus a plan that follows the heuristic controller, so the
+// search never does worse than either. All buffers are static.
+
+// Depth and budget can be set at build time to tune them with race.cpp
+#ifndef SEARCH_DEPTH
+#define SEARCH_DEPTH 6
+#endif
+#ifndef SEARCH_BUDGET_MS
+#define SEARCH_BUDGET_MS 40.0
+#endif
+#define SEARCH_FIRST_BUDGET_MS 400.0
+#define SEARCH_POPULATION 12
+#define SEARCH_BATCH 8 // plans simulated side by side
+
+#if SEARCH_DEPTH > PREDICT_DEPTH
+#error "SEARCH_DEPTH needs the opponent predicted at least as far: raise PREDICT_DEPTH"
+#endif
+#define CHECKPOINT_SCORE 50000.0
+#define ENTRY_WEIGHT 5.0 // per degree off the entry angle, at the checkpoint
+#define ENTRY_RANGE 3000.0
+
+typedef struct
+{
+	int8_t turn;   // degrees, -18..18
+	int8_t thrust; // 0..100 or THRUST_BOOST
+} Gene;
+
+typedef struct
+{
+	Gene genes[SEARCH_DEPTH];
+	double score;
+} Plan;
+
+typedef struct
+{
+	Plan population[SEARCH_POPULATION];
+	Plan best;
+	bool has_best;
+	uint32_t rng;
+	long long simulated_ticks; // total, for the harness
+	int generations;		   // last decision
+} Search;
+
+static inline double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static inline uint32_t search_rand(Search *s)
+{
+	// xorshift32
+	uint32_t x = s->rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return s->rng = x;
+}
+
+static inline int search_range(Search *s, int lo, int hi)
+{
+	return lo + (int)(search_rand(s) % (uint32_t)(hi - lo + 1));
+}
+
+static inline Gene random_gene(Search *s)
+{
+	Gene g;
+	int r = search_range(s, 0, 9);
+	g.turn = (int8_t)(r < 3 ? search_range(s, -(int)MAX_TURN, (int)MAX_TURN) : (r < 6 ? (r - 4) * (int)MAX_TURN : 0));
+	r = search_range(s, 0, 39);
+	g.thrust = (int8_t)(r < 2 ? THRUST_BOOST : (r < 3 ? THRUST_SHIELD : (r < 20 ? MAX_THRUST : search_range(s, 0, MAX_THRUST))));
+	return g;
+}
+
+static inline void mutate_gene(Search *s, Gene *g, double amplitude)
+{
+	int t = g->turn + (int)((search_range(s, -(int)MAX_TURN, (int)MAX_TURN)) * amplitude);
+	g->turn = (int8_t)(t > MAX_TURN ? MAX_TURN : (t < -MAX_TURN ? -MAX_TURN : t));
+	if (search_range(s, 0, 9) == 0)
+		g->thrust = (int8_t)(search_range(s, 0, 19) == 0 ? THRUST_BOOST : MAX_THRUST);
+	else
+	{
+		int base = g->thrust < 0 ? MAX_THRUST : g->thrust;
+		int th = base + (int)(search_range(s, -MAX_THRUST, MAX_THRUST) * amplitude);
+		g->thrust = (int8_t)(th > MAX_THRUST ? MAX_THRUST : (th < 0 ? 0 : th));
+	}
+}
+
+static inline double pod_progress(const Pod *pod, const Track *track)
+{
+	int cp = pod->next_checkpoint;
+	double dx = track->x[cp] - pod->x, dy = track->y[cp] - pod->y;
+	return pod->passed * CHECKPOINT_SCORE - sqrt(dx * dx + dy * dy);
+}
+
+// Progress after the plan: checkpoints taken, then closeness to the next
+// one. On a known course, also how well the pod's heading lines up with the
+// next entry angle as it gets close, and a BOOST away from the longest leg
+// costs half a checkpoint. When intercepting, the score is how far the
+// opponent is held back instead, keeping near its next checkpoint.
+static inline double plan_score(const Pod *pod, const Pod *op, int boost_leg, const Course *course, const Opponent *o)
+{
+	const Track *track = &course->track;
+	if (o->intercept)
+	{
+		int cp = op->next_checkpoint;
+		double dx = o->track->x[cp] - pod->x, dy = o->track->y[cp] - pod->y;
+		return -pod_progress(op, o->track) - 0.5 * sqrt(dx * dx + dy * dy);
+	}
+
+	double score = pod->passed * CHECKPOINT_SCORE;
+	if (!pod_finished(pod, track))
+	{
+		int cp = pod->next_checkpoint;
+		double dx = track->x[cp] - pod->x, dy = track->y[cp] - pod->y;
+		double dist = sqrt(dx * dx + dy * dy);
+		score -= dist;
+		if (course->complete && dist < ENTRY_RANGE && (pod->vx != 0 || pod->vy != 0))
+		{
+			double heading = atan2(pod->vy, pod->vx) / DEG_TO_RAD;
+			double off = fabs(normalize_angle(heading - course->entry_angle[cp] + 180.0) - 180.0);
+			score -= off * ENTRY_WEIGHT * (1.0 - dist / ENTRY_RANGE);
+		}
+	}
+	if (course->complete && boost_leg >= 0 && boost_leg != course->longest_leg)
+		score -= CHECKPOINT_SCORE / 2;
+	return score;
+}
+
+// Simulate up to SEARCH_BATCH plans tick by tick in lockstep, so each tick's
+// predicted opponent state is read once for the whole batch. A plan leaves
+// the shared prediction only when the cheap reach test says it may touch
+// the opponent; from then on it carries its own opponent copy.
+static inline void plan_evaluate_batch(Search *s, const Pod *start, const Course *course, const Opponent *o, Plan *plans, int n)
+{
+	const Track *track = &course->track;
+	Pod me[SEARCH_BATCH], op[SEARCH_BATCH];
+	bool own[SEARCH_BATCH];
+	int boost_leg[SEARCH_BATCH];
+	for (int j = 0; j < n; ++j)
+	{
+		me[j] = *start;
+		own[j] = false;
+		boost_leg[j] = -1;
+	}
+
+	for (int i = 0; i < SEARCH_DEPTH; ++i)
+	{
+		const Pod *predicted = &o->path[i];
+		for (int j = 0; j < n; ++j)
+		{
+			if (pod_finished(&me[j], track))
+				continue;
+			Gene g = plans[j].genes[i];
+			if (g.thrust == THRUST_BOOST && !me[j].boost_used)
+				boost_leg[j] = me[j].next_checkpoint;
+
+			int push = g.thrust == THRUST_BOOST && !me[j].boost_used ? BOOST_THRUST : MAX_THRUST;
+			if (o->present && pods_may_touch(&me[j], own[j] ? &op[j] : predicted, push, MAX_THRUST))
+			{
+				if (!own[j])
+				{
+					op[j] = *predicted;
+					own[j] = true;
+				}
+				double turn;
+				int thrust;
+				opponent_action(&op[j], o->track, &turn, &thrust);
+				pods_step(&me[j], track, g.turn, g.thrust, &op[j], o->track, turn, thrust);
+			}
+			else
+			{
+				pod_step(&me[j], track, g.turn, g.thrust);
+				if (own[j])
+				{
+					double turn;
+					int thrust;
+					opponent_action(&op[j], o->track, &turn, &thrust);
+					pod_step(&op[j], o->track, turn, thrust);
+				}
+			}
+		}
+	}
+	s->simulated_ticks += n * SEARCH_DEPTH;
+
+	for (int j = 0; j < n; ++j)
+		plans[j].score = plan_score(&me[j], own[j] ? &op[j] : &o->path[SEARCH_DEPTH], boost_leg[j], course, o);
+}
+
+// Plan that follows the heuristic controller tick by tick
+static inline void heuristic_plan(const Pod *start, const Course *course, int previous_thrust, Plan *plan)
+{
+	const Track *track = &course->track;
+	Pod pod = *start;
+	for (int i = 0; i < SEARCH_DEPTH; ++i)
+	{
+		int cp = pod.next_checkpoint;
+		double turn = pod_diff_angle(&pod, track->x[cp], track->y[cp]);
+		double dx = track->x[cp] - pod.x, dy = track->y[cp] - pod.y;
+		int thrust = heuristic_decide((int)sqrt(dx * dx + dy * dy), (int)turn, &previous_thrust);
+		if (turn > MAX_TURN)
+			turn = MAX_TURN;
+		else if (turn < -MAX_TURN)
+			turn = -MAX_TURN;
+		plan->genes[i].turn = (int8_t)turn;
+		plan->genes[i].thrust = (int8_t)(thrust == THRUST_BOOST && pod.boost_used ? MAX_THRUST : thrust);
+		pod_step(&pod, track, turn, thrust);
+	}
+}
+
+// Best (turn, thrust) for this tick within budget_ms. pod->angle must be set.
+static inline Gene search_decide(Search *s, const Pod *pod, const Course *course, const Opponent *o, int previous_thrust, double budget_ms)
+{
+	double deadline = now_ms() + budget_ms;
+	if (s->rng == 0)
+		s->rng = 0x9e3779b9u;
+
+	// Seeds: last tick's best moved on by one, and the heuristic
+	int n = 0;
+	if (s->has_best)
+	{
+		Plan *p = &s->population[n++];
+		for (int i = 0; i + 1 < SEARCH_DEPTH; ++i)
+			p->genes[i] = s->best.genes[i + 1];
+		p->genes[SEARCH_DEPTH - 1] = s->best.genes[SEARCH_DEPTH - 1];
+	}
+	heuristic_plan(pod, course, previous_thrust, &s->population[n++]);
+	if (o->present && pods_may_touch(pod, &o->path[0], MAX_THRUST, MAX_THRUST))
+	{
+		// A hit may be coming: try taking it behind a SHIELD
+		s->population[n] = s->population[0];
+		s->population[n++].genes[0].thrust = THRUST_SHIELD;
+	}
+	int seeds = n;
+	while (n < SEARCH_POPULATION)
+	{
+		Plan *p = &s->population[n];
+		if (n % 2)
+		{
+			*p = s->population[n % seeds];
+			for (int i = 0; i < SEARCH_DEPTH; ++i)
+				mutate_gene(s, &p->genes[i], 0.5);
+		}
+		else
+			for (int i = 0; i < SEARCH_DEPTH; ++i)
+				p->genes[i] = random_gene(s);
+		n++;
+	}
+
+	for (int i = 0; i < SEARCH_POPULATION; i += SEARCH_BATCH)
+		plan_evaluate_batch(s, pod, course, o, &s->population[i],
+							SEARCH_POPULATION - i < SEARCH_BATCH ? SEARCH_POPULATION - i : SEARCH_BATCH);
+	int best = 0;
+	for (int i = 1; i < SEARCH_POPULATION; ++i)
+		if (s->population[i].score > s->population[best].score)
+			best = i;
+
+	// Steady-state evolution: a batch of mutated tournament winners, each
+	// replacing the worst plan if it beats it
+	s->generations = 0;
+	Plan children[SEARCH_BATCH];
+	while (now_ms() < deadline)
+	{
+		for (int k = 0; k < SEARCH_BATCH; ++k)
+		{
+			int a = search_range(s, 0, SEARCH_POPULATION - 1), b = search_range(s, 0, SEARCH_POPULATION - 1);
+			Plan *child = &children[k];
+			*child = s->population[s->population[a].score > s->population[b].score ? a : b];
+			double amplitude = search_range(s, 0, 3) == 0 ? 1.0 : 0.2;
+			for (int i = 0; i < SEARCH_DEPTH; ++i)
+				if (search_range(s, 0, SEARCH_DEPTH - 1) < 2)
+					mutate_gene(s, &child->genes[i], amplitude);
+		}
+		plan_evaluate_batch(s, pod, course, o, children, SEARCH_BATCH);
+
+		for (int k = 0; k < SEARCH_BATCH; ++k)
+		{
+			int worst = 0;
+			for (int i = 1; i < SEARCH_POPULATION; ++i)
+				if (s->population[i].score < s->population[worst].score)
+					worst = i;
+			if (children[k].score > s->population[worst].score)
+			{
+				s->population[worst] = children[k];
+				if (children[k].score > s->population[best].score)
+					best = worst;
+			}
+		}
+		s->generations += SEARCH_BATCH;
+	}
+
+	s->best = s->population[best];
+	s->has_best = true;
+	return s->best.genes[0];
+}
+
+// Point for the game's "x y" output that makes the pod turn by `turn`
+static inline void gene_target(const Pod *pod, const Gene *g, int *tx, int *ty)
+{
+	double a = ((pod->angle < 0 ? 0 : pod->angle) + g->turn) * DEG_TO_RAD;
+	*tx = (int)floor(pod->x + cos(a) * 10000.0 + 0.5);
+	*ty = (int)floor(pod->y + sin(a) * 10000.0 + 0.5);
+}
+
+/* ==========================================
+   TELEMETRY
+   ========================================== */
+
+// MPR_DEBUG 0 compiles all of this out. At 1 every tick's state and
+// decision is kept in a fixed ring of binary records and only written by
+// telemetry_flush, whenever a harness asks. 2 also prints a line per tick to
+// stderr, for reading in the IDE.
+//
+// A flush writes a TelemetryHeader and then the kept records, oldest first,
+// and empties the ring, so a log is a sequence of such chunks.
+//
+// The game never tells the bot it is over, it just stops the process, so
+// main flushes to $MPR_TELEMETRY as it goes (telemetry_due) rather than
+// after its loop. Without the variable nothing is written.
+
+#ifndef MPR_DEBUG
+#define MPR_DEBUG 0
+#endif
+
+#define TELEMETRY_CAPACITY 1024 // records kept, the oldest are overwritten
+#define TELEMETRY_MAGIC 0x5452504du // "MPRT"
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_FLUSH_TICKS 64 // chunk length while racing, well inside the ring
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t count;
+} TelemetryHeader;
+
+typedef struct
+{
+	uint16_t tick;
+	uint8_t next_checkpoint;
+	uint8_t passed;
+	int16_t x, y, vx, vy, angle;
+	int16_t opponent_x, opponent_y;
+	int16_t target_x, target_y;
+	int16_t thrust; // 0..100, THRUST_BOOST or THRUST_SHIELD
+	uint8_t course_complete;
+	uint8_t intercept;
+	uint32_t generations;
+	float decision_ms;
+} TelemetryRecord;
+
+typedef struct
+{
+	TelemetryRecord records[TELEMETRY_CAPACITY];
+	uint32_t written; // since the last flush; the ring holds the last TELEMETRY_CAPACITY
+} Telemetry;
+
+static inline TelemetryRecord *telemetry_next(Telemetry *t)
+{
+	return &t->records[t->written++ % TELEMETRY_CAPACITY];
+}
+
+static inline bool telemetry_flush(Telemetry *t, FILE *out)
+{
+	uint32_t count = t->written < TELEMETRY_CAPACITY ? t->written : TELEMETRY_CAPACITY;
+	TelemetryHeader header = {TELEMETRY_MAGIC, TELEMETRY_VERSION, (uint32_t)sizeof(TelemetryRecord), count};
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+	for (uint32_t i = t->written - count; ok && i < t->written; ++i)
+		ok = fwrite(&t->records[i % TELEMETRY_CAPACITY], sizeof(TelemetryRecord), 1, out) == 1;
+	t->written = 0;
+	return fflush(out) == 0 && ok;
+}
+
+// Time for main to write a chunk: every TELEMETRY_FLUSH_TICKS, and every
+// tick on the last leg, since any of those ticks can be the game's last
+static inline bool telemetry_due(const Telemetry *t, const Tracker *tracker)
+{
+	const Track *track = &tracker->course.track;
+	bool last_leg = tracker->course.complete && tracker->me.passed + 1 >= track->count * track->laps;
+	return t->written >= TELEMETRY_FLUSH_TICKS || (last_leg && t->written > 0);
+}
+
+/* ==========================================
+   CONTROLLERS
+   ========================================== */
+
+// One tick of the game's input and the answer to it. thrust is 0..100,
+// THRUST_BOOST or THRUST_SHIELD. The bot and the original heuristic both
+// play through this, so race.cpp can run them against each other.
+
+typedef struct
+{
+	int x, y;
+	int next_checkpoint_x, next_checkpoint_y;
+	int next_checkpoint_dist;
+	int next_checkpoint_angle;
+	int opponent_x, opponent_y;
+} TurnInput;
+
+typedef struct
+{
+	int x, y;
+	int thrust;
+} TurnOutput;
+
+typedef struct
+{
+	Search search;
+	Tracker tracker;
+	Opponent opponent;
+	int thrust; // the heuristic's band thrust, for seeding
+	double budget_ms, first_budget_ms;
+#if MPR_DEBUG
+	Telemetry telemetry;
+#endif
+} Bot;
+
+static inline void bot_init(Bot *bot)
+{
+	memset(bot, 0, sizeof(*bot));
+	bot->budget_ms = SEARCH_BUDGET_MS;
+	bot->first_budget_ms = SEARCH_FIRST_BUDGET_MS;
+}
+
+static inline void bot_turn(Bot *bot, const TurnInput *in, TurnOutput *out)
+{
+#if MPR_DEBUG
+	double start_ms = now_ms();
+#endif
+	bool first_tick = bot->tracker.ticks == 0;
+	tracker_update(&bot->tracker, in->x, in->y, in->next_checkpoint_x, in->next_checkpoint_y, in->next_checkpoint_angle,
+				   in->opponent_x, in->opponent_y);
+	Course scratch;
+	Pod pod;
+	const Course *course = tracker_view(&bot->tracker, &scratch, &pod);
+	opponent_predict(&bot->opponent, &bot->tracker);
+
+	Gene move = search_decide(&bot->search, &pod, course, &bot->opponent, bot->thrust,
+							  first_tick ? bot->first_budget_ms : bot->budget_ms);
+	heuristic_decide(in->next_checkpoint_dist, in->next_checkpoint_angle, &bot->thrust);
+	tracker_commit(&bot->tracker, move.thrust);
+
+	gene_target(&pod, &move, &out->x, &out->y);
+	out->thrust = move.thrust == THRUST_BOOST && pod.boost_used ? MAX_THRUST : move.thrust;
+
+#if MPR_DEBUG
+	TelemetryRecord *r = telemetry_next(&bot->telemetry);
+	r->tick = (uint16_t)bot->tracker.ticks;
+	r->next_checkpoint = bot->tracker.me.next_checkpoint;
+	r->passed = bot->tracker.me.passed;
+	r->x = pod.x;
+	r->y = pod.y;
+	r->vx = pod.vx;
+	r->vy = pod.vy;
+	r->angle = pod.angle;
+	r->opponent_x = (int16_t)in->opponent_x;
+	r->opponent_y = (int16_t)in->opponent_y;
+	r->target_x = (int16_t)out->x;
+	r->target_y = (int16_t)out->y;
+	r->thrust = (int16_t)out->thrust;
+	r->course_complete = bot->tracker.course.complete;
+	r->intercept = bot->opponent.intercept;
+	r->generations = (uint32_t)bot->search.generations;
+	r->decision_ms = (float)(now_ms() - start_ms);
+#if MPR_DEBUG >= 2
+	fprintf(stderr, "tick %d at %d %d v %d %d cp %d/%d -> %d %d %d (%u plans, %.2f ms)\n", r->tick, r->x, r->y, r->vx, r->vy,
+			r->next_checkpoint, r->passed, r->target_x, r->target_y, r->thrust, r->generations, r->decision_ms);
+#endif
+#endif
+}
+
+// The original controller: straight at the checkpoint, thrust from the angle
+static inline void heuristic_turn(int *previous_thrust, const TurnInput *in, TurnOutput *out)
+{
+	out->x = in->next_checkpoint_x;
+	out->y = in->next_checkpoint_y;
+	out->thrust = heuristic_decide(in->next_checkpoint_dist, in->next_checkpoint_angle, previous_thrust);
+}
+
 /**
  * Auto-generated code below aims at helping you parse
  * the standard input according to the problem statement.
  **/
 
+// Harnesses that drive the controllers themselves build with MPR_NO_MAIN
+#ifndef MPR_NO_MAIN
 int main()
 {
 	// game loop
-	int thrust = 0;
+	static Bot bot;
+	bot_init(&bot);
+#if MPR_DEBUG
+	const char *path = getenv("MPR_TELEMETRY");
+	FILE *log = path ? fopen(path, "wb") : NULL;
+#endif
 	while (1)
 	{
 		int x;
@@ -73,28 +1082,44 @@ int main()
 		int next_checkpoint_dist;
 		// angle between your pod orientation and the direction of the next checkpoint
 		int next_checkpoint_angle;
-		scanf("%d%d%d%d%d%d", &x, &y, &next_checkpoint_x, &next_checkpoint_y, &next_checkpoint_dist, &next_checkpoint_angle);
+		if (scanf("%d%d%d%d%d%d", &x, &y, &next_checkpoint_x, &next_checkpoint_y, &next_checkpoint_dist, &next_checkpoint_angle) != 6)
+			break;
 		int opponent_x;
 		int opponent_y;
 		scanf("%d%d", &opponent_x, &opponent_y);
 
 		// Write an action using printf(). DON'T FORGET THE TRAILING \n
-		// To debug: fprintf(stderr, "Debug messages...\n");
+		// Debug output goes through the telemetry ring (MPR_DEBUG), not stderr
+		TurnInput in = {x, y, next_checkpoint_x, next_checkpoint_y, next_checkpoint_dist, next_checkpoint_angle, opponent_x, opponent_y};
 
 		// You have to output the target position
 		// followed by the power (0 <= thrust <= 100)
 		// i.e.: "x y thrust"
-		fprintf(stderr, "next_checkpoint_dist: %d\n", next_checkpoint_dist);
-		fprintf(stderr, "next_checkpoint_x: %d\n", next_checkpoint_x);
-		fprintf(stderr, "next_checkpoint_y: %d\n", next_checkpoint_y);
-		thrust = calculate_thrust(next_checkpoint_angle, thrust);
-		if (next_checkpoint_dist < 10000 && next_checkpoint_dist > 3000 && abs(next_checkpoint_angle) < 40)
-			printf("%d %d BOOST\n", next_checkpoint_x, next_checkpoint_y);
-		else if (next_checkpoint_dist < 2500)
-			printf("%d %d %d\n", next_checkpoint_x, next_checkpoint_y, abs(thrust - 20));
+		TurnOutput out;
+		bot_turn(&bot, &in, &out);
+		if (out.thrust == THRUST_SHIELD)
+			printf("%d %d SHIELD\n", out.x, out.y);
+		else if (out.thrust == THRUST_BOOST)
+			printf("%d %d BOOST\n", out.x, out.y);
 		else
-			printf("%d %d %d\n", next_checkpoint_x, next_checkpoint_y, thrust);
+			printf("%d %d %d\n", out.x, out.y, out.thrust);
+		fflush(stdout);
+
+#if MPR_DEBUG
+		// After the answer is out, so the write is not on the tick's clock
+		if (log && telemetry_due(&bot.telemetry, &bot.tracker))
+			telemetry_flush(&bot.telemetry, log);
+#endif
 	}
 
+#if MPR_DEBUG
+	// Input ran out (a local run): write what is left
+	if (log)
+	{
+		telemetry_flush(&bot.telemetry, log);
+		fclose(log);
+	}
+#endif
 	return 0;
-}
\ No newline at end of file
+}
+#endif
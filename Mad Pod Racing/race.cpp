@@ -0,0 +1,566 @@
+// Offline race harness for Mad Pod Racing.cpp: generates random checkpoint
+// maps, races two controllers head-to-head on the pod engine (collisions
+// included) and reports finish times, laps, decision latency and simulation
+// throughput.
+//
+//   g++ -O2 -o race race.cpp
+//   ./race search heuristic
+//   ./race --races 50 --seed 3 --budget 10 search search
+//   g++ -O2 -DSEARCH_DEPTH=8 -o race8 race.cpp && ./race8 --budget 40
+//
+// Controllers: "search" (the bot) and "heuristic" (the original thrust
+// bands). Every map is raced twice with the start sides swapped. Like the
+// game, a pod that goes TIMEOUT_TICKS without a checkpoint is out, and the
+// first pod home wins; the other keeps racing so both get a finish time.
+//
+// --budget is the search's per-tick budget in ms (default 5, first tick
+// included, so runs stay short); pass 40 to race at the real time limit.
+//
+// The bot is built with telemetry on (MPR_DEBUG 1). --telemetry FILE writes
+// one chunk per race for each search controller; --replay FILE summarises a
+// log, from here or from a bot run with MPR_TELEMETRY=FILE.
+//
+//   ./race --races 5 --telemetry races.mprt && ./race --replay races.mprt
+//
+// --record FILE writes the first race's turn input as the first controller
+// saw it, in the game's stdin format; --transcript FILE steps the bot over
+// such a file (or any captured stdin) through the shared runtime
+// (common/runtime.h) and reports per-tick latency and an output checksum.
+//
+//   ./race --races 1 --record race.in && ./race --budget 40 --transcript race.in
+
+#define MPR_NO_MAIN
+#ifndef MPR_DEBUG
+#define MPR_DEBUG 1
+#endif
+#include "Mad Pod Racing.cpp"
+#include "../common/runtime.h"
+
+#define TIMEOUT_TICKS 100
+#define MAX_RACE_TICKS 1000
+#define MIN_CHECKPOINT_GAP 2500
+#define MAP_MARGIN 1500
+#define START_OFFSET 500
+#define MAX_RACES 2048
+
+/* ==========================================
+   CONTROLLERS
+   ========================================== */
+
+typedef enum
+{
+	CONTROLLER_SEARCH,
+	CONTROLLER_HEURISTIC
+} ControllerKind;
+
+static const char *CONTROLLER_NAMES[] = {"search", "heuristic"};
+
+typedef struct
+{
+	ControllerKind kind;
+	Bot bot;
+	int thrust; // heuristic's band thrust
+} Controller;
+
+static bool controller_parse(const char *name, ControllerKind *kind)
+{
+	for (int k = 0; k < 2; ++k)
+		if (strcmp(name, CONTROLLER_NAMES[k]) == 0)
+		{
+			*kind = (ControllerKind)k;
+			return true;
+		}
+	return false;
+}
+
+static void controller_reset(Controller *c, double budget_ms)
+{
+	bot_init(&c->bot);
+	c->bot.budget_ms = c->bot.first_budget_ms = budget_ms;
+	c->thrust = 0;
+}
+
+static void controller_turn(Controller *c, const TurnInput *in, TurnOutput *out)
+{
+	if (c->kind == CONTROLLER_SEARCH)
+		bot_turn(&c->bot, in, out);
+	else
+		heuristic_turn(&c->thrust, in, out);
+}
+
+/* ==========================================
+   MAPS
+   ========================================== */
+
+static uint32_t rng_next(uint32_t *state)
+{
+	// xorshift32
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static int rng_range(uint32_t *state, int lo, int hi)
+{
+	return lo + (int)(rng_next(state) % (uint32_t)(hi - lo + 1));
+}
+
+// 3..MAX_CHECKPOINTS checkpoints, kept apart and away from the walls
+static void random_track(uint32_t *state, Track *track)
+{
+	track->count = rng_range(state, 3, MAX_CHECKPOINTS);
+	track->laps = DEFAULT_LAPS;
+	for (int i = 0; i < track->count; ++i)
+	{
+		bool ok = false;
+		for (int attempt = 0; attempt < 100 && !ok; ++attempt)
+		{
+			track->x[i] = rng_range(state, MAP_MARGIN, MAP_WIDTH - MAP_MARGIN);
+			track->y[i] = rng_range(state, MAP_MARGIN, MAP_HEIGHT - MAP_MARGIN);
+			ok = true;
+			for (int j = 0; j < i && ok; ++j)
+			{
+				double dx = track->x[i] - track->x[j], dy = track->y[i] - track->y[j];
+				ok = dx * dx + dy * dy >= (double)MIN_CHECKPOINT_GAP * MIN_CHECKPOINT_GAP;
+			}
+		}
+	}
+}
+
+/* ==========================================
+   REFEREE
+   ========================================== */
+
+typedef struct
+{
+	int finish_tick; // -1 if it never finished
+	int laps;		 // completed when the race was decided
+	bool won;
+	bool timed_out;
+} RaceResult;
+
+typedef struct
+{
+	double *decision_ms;
+	int decisions, capacity;
+	long long search_ticks;
+	double search_ms;
+	int races, wins, finished, timeouts;
+	int finish_ticks[2 * MAX_RACES];
+	int lap_counts[DEFAULT_LAPS + 1];
+} ControllerStats;
+
+static void stats_add_decision(ControllerStats *s, double ms)
+{
+	if (s->decisions == s->capacity)
+	{
+		s->capacity = s->capacity ? s->capacity * 2 : 4096;
+		s->decision_ms = (double *)realloc(s->decision_ms, s->capacity * sizeof(double));
+	}
+	s->decision_ms[s->decisions++] = ms;
+}
+
+static TurnInput make_input(const Pod *pod, const Pod *opponent, const Track *track)
+{
+	int cp = pod->next_checkpoint;
+	double dx = track->x[cp] - pod->x, dy = track->y[cp] - pod->y;
+	TurnInput in;
+	in.x = pod->x;
+	in.y = pod->y;
+	in.next_checkpoint_x = track->x[cp];
+	in.next_checkpoint_y = track->y[cp];
+	in.next_checkpoint_dist = (int)floor(sqrt(dx * dx + dy * dy) + 0.5);
+	in.next_checkpoint_angle = (int)floor(pod_diff_angle(pod, track->x[cp], track->y[cp]) + 0.5);
+	in.opponent_x = opponent->x;
+	in.opponent_y = opponent->y;
+	return in;
+}
+
+// Both pods start on checkpoint 0, side by side across the first leg, facing
+// checkpoint 1
+static void start_pods(const Track *track, Pod pods[2])
+{
+	double dx = track->x[1] - track->x[0], dy = track->y[1] - track->y[0];
+	double len = sqrt(dx * dx + dy * dy);
+	for (int i = 0; i < 2; ++i)
+	{
+		double side = i == 0 ? -START_OFFSET : START_OFFSET;
+		memset(&pods[i], 0, sizeof(Pod));
+		pods[i].x = (int16_t)floor(track->x[0] - dy / len * side + 0.5);
+		pods[i].y = (int16_t)floor(track->y[0] + dx / len * side + 0.5);
+		pods[i].next_checkpoint = 1;
+		pods[i].angle = (int16_t)floor(pod_angle_to(&pods[i], track->x[1], track->y[1]) + 0.5) % 360;
+	}
+}
+
+// input_log, if set, gets every turn input c[0] sees, as stdin lines
+static void race(const Track *track, Controller *c[2], ControllerStats *stats[2], double budget_ms, RaceResult result[2], FILE *input_log)
+{
+	Pod pods[2];
+	start_pods(track, pods);
+	int since_checkpoint[2] = {0, 0};
+	bool out[2] = {false, false};
+	int winner = -1;
+	bool decided = false;
+	for (int i = 0; i < 2; ++i)
+	{
+		controller_reset(c[i], budget_ms);
+		result[i].finish_tick = -1;
+		result[i].laps = 0;
+		result[i].won = false;
+		result[i].timed_out = false;
+	}
+
+	for (int tick = 1; tick <= MAX_RACE_TICKS && !(out[0] && out[1]); ++tick)
+	{
+		double turn[2];
+		int thrust[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			if (out[i])
+				continue;
+			TurnInput in = make_input(&pods[i], &pods[1 - i], track);
+			if (input_log && i == 0)
+				fprintf(input_log, "%d %d %d %d %d %d\n%d %d\n", in.x, in.y, in.next_checkpoint_x, in.next_checkpoint_y,
+						in.next_checkpoint_dist, in.next_checkpoint_angle, in.opponent_x, in.opponent_y);
+			TurnOutput o;
+			long long ticks_before = c[i]->bot.search.simulated_ticks;
+			double t0 = now_ms();
+			controller_turn(c[i], &in, &o);
+			double ms = now_ms() - t0;
+			stats_add_decision(stats[i], ms);
+			if (c[i]->kind == CONTROLLER_SEARCH)
+			{
+				stats[i]->search_ticks += c[i]->bot.search.simulated_ticks - ticks_before;
+				stats[i]->search_ms += ms;
+			}
+			turn[i] = pod_diff_angle(&pods[i], o.x, o.y);
+			thrust[i] = o.thrust;
+		}
+
+		int passed[2] = {pods[0].passed, pods[1].passed};
+		if (!out[0] && !out[1])
+			pods_step(&pods[0], track, turn[0], thrust[0], &pods[1], track, turn[1], thrust[1]);
+		else
+			for (int i = 0; i < 2; ++i)
+				if (!out[i])
+					pod_step(&pods[i], track, turn[i], thrust[i]);
+
+		for (int i = 0; i < 2; ++i)
+		{
+			if (out[i])
+				continue;
+			since_checkpoint[i] = pods[i].passed != passed[i] ? 0 : since_checkpoint[i] + 1;
+			if (pod_finished(&pods[i], track))
+			{
+				out[i] = true;
+				result[i].finish_tick = tick;
+				if (winner < 0)
+					winner = i;
+			}
+			else if (since_checkpoint[i] >= TIMEOUT_TICKS)
+			{
+				out[i] = true;
+				result[i].timed_out = true;
+			}
+		}
+		if (winner >= 0 && !decided)
+		{
+			decided = true;
+			for (int i = 0; i < 2; ++i)
+				result[i].laps = pods[i].passed / track->count;
+		}
+	}
+
+	// Nobody finished: the further pod wins, as the game ranks by progress
+	if (!decided)
+	{
+		for (int i = 0; i < 2; ++i)
+			result[i].laps = pods[i].passed / track->count;
+		if (pods[0].passed != pods[1].passed)
+			winner = pods[0].passed > pods[1].passed ? 0 : 1;
+	}
+	if (winner >= 0)
+		result[winner].won = true;
+}
+
+/* ==========================================
+   REPORT
+   ========================================== */
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+static int compare_int(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void record(ControllerStats *s, const RaceResult *r)
+{
+	s->races++;
+	s->wins += r->won;
+	s->timeouts += r->timed_out;
+	if (r->finish_tick >= 0 && s->finished < (int)(sizeof(s->finish_ticks) / sizeof(int)))
+		s->finish_ticks[s->finished++] = r->finish_tick;
+	s->lap_counts[r->laps > DEFAULT_LAPS ? DEFAULT_LAPS : r->laps]++;
+}
+
+static void report(const char *name, ControllerStats *s)
+{
+	printf("%-10s wins %d/%d, finished %d, timeouts %d\n", name, s->wins, s->races, s->finished, s->timeouts);
+	if (s->finished > 0)
+	{
+		qsort(s->finish_ticks, s->finished, sizeof(int), compare_int);
+		double sum = 0;
+		for (int i = 0; i < s->finished; ++i)
+			sum += s->finish_ticks[i];
+		printf("%-10s finish ticks mean %.1f p10 %d p50 %d p90 %d\n", "", sum / s->finished,
+			   s->finish_ticks[s->finished / 10], s->finish_ticks[s->finished / 2], s->finish_ticks[s->finished * 9 / 10]);
+	}
+	printf("%-10s laps when decided:", "");
+	for (int l = 0; l <= DEFAULT_LAPS; ++l)
+		printf(" %d:%d", l, s->lap_counts[l]);
+	printf("\n");
+	if (s->decisions > 0)
+	{
+		qsort(s->decision_ms, s->decisions, sizeof(double), compare_double);
+		printf("%-10s decision ms p50 %.3f p99 %.3f max %.3f over %d ticks\n", "",
+			   s->decision_ms[s->decisions / 2], s->decision_ms[s->decisions * 99 / 100], s->decision_ms[s->decisions - 1], s->decisions);
+	}
+	if (s->search_ms > 0)
+		printf("%-10s search %.2fM simulated ticks/s\n", "", s->search_ticks / s->search_ms / 1000.0);
+}
+
+/* ==========================================
+   REPLAY
+   ========================================== */
+
+// One line per telemetry chunk: length, progress, when BOOST and SHIELD
+// went out, time spent intercepting, and the decision cost
+static int replay_log(const char *path)
+{
+	FILE *in = fopen(path, "rb");
+	if (!in)
+	{
+		fprintf(stderr, "cannot open %s\n", path);
+		return 1;
+	}
+
+	static TelemetryRecord records[TELEMETRY_CAPACITY];
+	static double ms[TELEMETRY_CAPACITY];
+	TelemetryHeader header;
+	int chunks = 0;
+	while (fread(&header, sizeof(header), 1, in) == 1)
+	{
+		if (header.magic != TELEMETRY_MAGIC || header.version != TELEMETRY_VERSION ||
+			header.record_size != sizeof(TelemetryRecord) || header.count > TELEMETRY_CAPACITY)
+		{
+			fprintf(stderr, "%s: chunk %d is not a version %d telemetry log\n", path, chunks, TELEMETRY_VERSION);
+			break;
+		}
+		if (fread(records, sizeof(TelemetryRecord), header.count, in) != header.count)
+		{
+			fprintf(stderr, "%s: chunk %d is truncated\n", path, chunks);
+			break;
+		}
+		if (header.count == 0)
+			continue;
+
+		int boost_tick = -1, shields = 0, intercepting = 0;
+		double plans = 0;
+		for (uint32_t i = 0; i < header.count; ++i)
+		{
+			const TelemetryRecord *r = &records[i];
+			if (r->thrust == THRUST_BOOST && boost_tick < 0)
+				boost_tick = r->tick;
+			shields += r->thrust == THRUST_SHIELD;
+			intercepting += r->intercept;
+			plans += r->generations;
+			ms[i] = r->decision_ms;
+		}
+		qsort(ms, header.count, sizeof(double), compare_double);
+		const TelemetryRecord *last = &records[header.count - 1];
+		printf("chunk %3d ticks %4d-%-4d passed %2d boost %4d shields %2d intercept %3d plans/tick %7.0f ms p50 %.3f max %.3f\n",
+			   chunks, records[0].tick, last->tick, last->passed, boost_tick, shields, intercepting,
+			   plans / header.count, ms[header.count / 2], ms[header.count - 1]);
+		chunks++;
+	}
+	fclose(in);
+	printf("%d chunks\n", chunks);
+	return 0;
+}
+
+// Raw engine speed: two pods chasing each other so they keep colliding,
+// restarted every 100 ticks
+static double engine_ticks_per_second(const Track *track)
+{
+	Pod pods[2];
+	const int ticks = 2000000;
+	double t0 = now_ms();
+	for (int t = 0; t < ticks; ++t)
+	{
+		if (t % 100 == 0)
+			start_pods(track, pods);
+		pods_step(&pods[0], track, pod_diff_angle(&pods[0], pods[1].x, pods[1].y), MAX_THRUST,
+				  &pods[1], track, pod_diff_angle(&pods[1], pods[0].x, pods[0].y), MAX_THRUST);
+	}
+	double ms = now_ms() - t0;
+	return 2.0 * ticks / ms * 1000.0;
+}
+
+/* ==========================================
+   TRANSCRIPTS
+   ========================================== */
+
+// The bot behind the runtime's step() interface: one tick of stdin in, one
+// command line out, as main() would print it
+struct MprProgram
+{
+	Bot bot;
+
+	bool step(rt::Reader &in, rt::Writer &out)
+	{
+		TurnInput t;
+		if (!in.read_int(t.x) || !in.read_int(t.y) || !in.read_int(t.next_checkpoint_x) ||
+			!in.read_int(t.next_checkpoint_y) || !in.read_int(t.next_checkpoint_dist) ||
+			!in.read_int(t.next_checkpoint_angle) || !in.read_int(t.opponent_x) || !in.read_int(t.opponent_y))
+			return false;
+		TurnOutput o;
+		bot_turn(&bot, &t, &o);
+		out.append((long long)o.x).put(' ').append((long long)o.y).put(' ');
+		if (o.thrust == THRUST_SHIELD)
+			out.append("SHIELD");
+		else if (o.thrust == THRUST_BOOST)
+			out.append("BOOST");
+		else
+			out.append((long long)o.thrust);
+		out.put('\n');
+		return true;
+	}
+};
+
+static int run_transcript(const char *path, double budget_ms, bool budget_set)
+{
+	std::string text;
+	if (!rt::read_file(path, text))
+	{
+		fprintf(stderr, "cannot open %s\n", path);
+		return 1;
+	}
+	static MprProgram program;
+	bot_init(&program.bot);
+	if (budget_set)
+		program.bot.budget_ms = program.bot.first_budget_ms = budget_ms;
+	rt::Reader in(text.data(), text.size());
+	rt::drive(program, in).print(path);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int races = 20;
+	uint32_t seed = 1;
+	double budget_ms = 5.0;
+	ControllerKind kinds[2] = {CONTROLLER_SEARCH, CONTROLLER_HEURISTIC};
+	int named = 0;
+	const char *telemetry_path = NULL;
+	const char *record_path = NULL;
+	const char *transcript_path = NULL;
+	bool budget_set = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--races") == 0 && i + 1 < argc)
+			races = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+		{
+			budget_ms = atof(argv[++i]);
+			budget_set = true;
+		}
+		else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc)
+			telemetry_path = argv[++i];
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			record_path = argv[++i];
+		else if (strcmp(argv[i], "--transcript") == 0 && i + 1 < argc)
+			transcript_path = argv[++i];
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			return replay_log(argv[i + 1]);
+		else if (named < 2 && controller_parse(argv[i], &kinds[named]))
+			named++;
+		else
+		{
+			fprintf(stderr, "usage: %s [--races N] [--seed S] [--budget MS] [--telemetry FILE] [--record FILE] [search|heuristic] [search|heuristic]\n"
+							"       %s --replay FILE\n"
+							"       %s [--budget MS] --transcript FILE\n",
+					argv[0], argv[0], argv[0]);
+			return 1;
+		}
+	}
+	if (races > MAX_RACES)
+		races = MAX_RACES;
+	if (seed == 0)
+		seed = 1;
+	if (transcript_path)
+		return run_transcript(transcript_path, budget_ms, budget_set);
+
+	FILE *telemetry = NULL;
+	if (telemetry_path && !(telemetry = fopen(telemetry_path, "wb")))
+	{
+		fprintf(stderr, "cannot write %s\n", telemetry_path);
+		return 1;
+	}
+	FILE *input_log = NULL;
+	if (record_path && !(input_log = fopen(record_path, "w")))
+	{
+		fprintf(stderr, "cannot write %s\n", record_path);
+		return 1;
+	}
+
+	static Controller controllers[2];
+	static ControllerStats stats[2];
+	controllers[0].kind = kinds[0];
+	controllers[1].kind = kinds[1];
+
+	printf("%d maps x 2 sides, seed %u, search depth %d, budget %.1f ms\n", races, seed, SEARCH_DEPTH, budget_ms);
+	uint32_t state = seed;
+	Track track;
+	for (int r = 0; r < races; ++r)
+	{
+		random_track(&state, &track);
+		for (int side = 0; side < 2; ++side)
+		{
+			Controller *c[2] = {&controllers[side], &controllers[1 - side]};
+			ControllerStats *st[2] = {&stats[side], &stats[1 - side]};
+			RaceResult result[2];
+			race(&track, c, st, budget_ms, result, r == 0 && side == 0 ? input_log : NULL);
+			record(st[0], &result[0]);
+			record(st[1], &result[1]);
+			for (int i = 0; i < 2 && telemetry; ++i)
+				if (c[i]->kind == CONTROLLER_SEARCH)
+					telemetry_flush(&c[i]->bot.telemetry, telemetry);
+		}
+	}
+
+	char name[2][32];
+	for (int i = 0; i < 2; ++i)
+		snprintf(name[i], sizeof(name[i]), "%s%s", CONTROLLER_NAMES[kinds[i]], kinds[0] == kinds[1] ? (i ? "#2" : "#1") : "");
+	report(name[0], &stats[0]);
+	report(name[1], &stats[1]);
+	printf("engine     %.2fM pod ticks/s\n", engine_ticks_per_second(&track) / 1e6);
+
+	if (telemetry)
+		fclose(telemetry);
+	if (input_log)
+		fclose(input_log);
+	free(stats[0].decision_ms);
+	free(stats[1].decision_ms);
+	return 0;
+}
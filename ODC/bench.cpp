@@ -0,0 +1,619 @@
+// Replay benchmark for odc.cpp: runs level files through Solver in-process,
+// playing the referee's side (resources, routes, pods), and reports latency,
+// allocations and a checksum of every action line.
+//
+//   g++ -O2 -std=c++17 -o bench bench.cpp
+//   ./bench test*.txt
+//   ./bench --synthetic 10 --seed 1 --repeat 3 test11.txt
+//   ./bench --record run.in test11.txt && ./bench --transcript run.in
+//
+// Built with -DODC_PROFILE=1 it also sums the solver's phase timers and
+// counters per level instead of printing them every turn.
+//
+// Level format: optional "xN" line, number of months, then per month
+// "numNew resources" followed by the new buildings ("type x y", pads add a
+// line of astronaut types). Ids go by order of appearance.
+//
+// --record writes the turn inputs the referee fed the solver, one level after
+// another, as the game's stdin would look; --transcript steps the solver over
+// such a file through the shared runtime (common/runtime.h), the same way the
+// other bots' harnesses drive theirs.
+//
+// Every turn must finish inside the solver's budget (FIRST_TURN_BUDGET_MS,
+// then TURN_BUDGET_MS), and turns that bring no new buildings must not
+// allocate; the bench names the levels where one did not and exits non-zero.
+// The budget check is only meaningful with the large case in it:
+//
+//   ./bench --synthetic 10 test*.txt
+//
+// Solver phases stop on the turn clock, so on a machine slow enough to hit
+// the budget the checksum can move; compare checksums on the same machine.
+
+#define ODC_NO_MAIN
+#include "odc.cpp"
+#include "../common/runtime.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <fcntl.h>
+
+// ==========================================
+// ALLOCATION COUNTER
+// ==========================================
+
+// Replaces the global operator new/delete with counting wrappers around
+// malloc/free; GCC cannot see that the pair matches
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static atomic<long long> g_allocs{0};
+
+void *operator new(size_t n)
+{
+	g_allocs.fetch_add(1, memory_order_relaxed);
+	if (void *p = malloc(n ? n : 1))
+		return p;
+	throw bad_alloc();
+}
+
+void *operator new[](size_t n)
+{
+	return operator new(n);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// ==========================================
+// LEVELS
+// ==========================================
+
+struct LevelBuilding
+{
+	int type, id, x, y;
+	vector<int> astronauts;
+};
+
+struct Month
+{
+	int resources;
+	vector<LevelBuilding> buildings;
+	vector<tuple<int, int, int>> routes; // pre-built before this month, u v capacity
+};
+
+struct Level
+{
+	string name;
+	vector<Month> months;
+};
+
+bool load_level(const string &path, Level &level)
+{
+	ifstream f(path);
+	if (!f)
+		return false;
+	vector<string> lines;
+	for (string line; getline(f, line);)
+		if (line.find_first_not_of(" \t\r") != string::npos)
+			lines.push_back(line);
+
+	size_t i = 0;
+	if (i < lines.size() && lines[i][0] == 'x')
+		i++;
+	if (i >= lines.size())
+		return false;
+	int months = stoi(lines[i++]);
+	int next_id = 0;
+	level.name = path;
+	level.months.clear();
+	for (int m = 0; m < months && i < lines.size(); ++m)
+	{
+		Month month;
+		int n;
+		istringstream(lines[i++]) >> n >> month.resources;
+		for (int k = 0; k < n && i < lines.size(); ++k)
+		{
+			LevelBuilding b;
+			istringstream(lines[i++]) >> b.type >> b.x >> b.y;
+			b.id = next_id++;
+			if (b.type == 0 && i < lines.size())
+			{
+				istringstream ast(lines[i++]);
+				for (int t; ast >> t;)
+					b.astronauts.push_back(t);
+			}
+			month.buildings.push_back(move(b));
+		}
+		level.months.push_back(move(month));
+	}
+	return true;
+}
+
+// ==========================================
+// SYNTHETIC MAPS
+// ==========================================
+
+// Random map with scale times the buildings and astronauts of the largest
+// level loaded, spread over the same number of months. Each month also
+// arrives with tubes to the earlier buildings (nearest neighbour, no
+// crossings), so route handling scales too.
+struct Lcg
+{
+	uint64_t s;
+	int next(int n)
+	{
+		s = s * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (int)((s >> 33) % (uint64_t)n);
+	}
+};
+
+Level synthetic_level(const vector<Level> &levels, int scale, uint64_t seed)
+{
+	int max_buildings = 9, max_astronauts = 30, months = 20;
+	for (const auto &l : levels)
+	{
+		int nb = 0, na = 0;
+		for (const auto &m : l.months)
+			for (const auto &b : m.buildings)
+			{
+				nb++;
+				na += b.astronauts.size();
+			}
+		if (nb > max_buildings)
+		{
+			max_buildings = nb;
+			max_astronauts = na;
+			months = l.months.size();
+		}
+	}
+
+	Lcg rng{seed};
+	int total = max_buildings * scale;
+	int pads = max(2, total / 4);
+	int per_pad = max(1, max_astronauts * scale / pads);
+	const int TYPES = 20;
+
+	Level level;
+	level.name = "synthetic x" + to_string(scale);
+	level.months.resize(months);
+	vector<LevelBuilding> all;
+	for (int id = 0; id < total; ++id)
+	{
+		LevelBuilding b;
+		b.id = id;
+		b.type = id % 4 == 0 ? 0 : 1 + rng.next(TYPES);
+		b.x = rng.next(161);
+		b.y = rng.next(91);
+		if (b.type == 0)
+			for (int k = 0; k < per_pad; ++k)
+				b.astronauts.push_back(1 + rng.next(TYPES));
+		level.months[(long long)id * months / total].buildings.push_back(b);
+		all.push_back(move(b));
+	}
+
+	// Pre-built tubes: from each building of an earlier month to its nearest
+	// earlier neighbour, skipped if it would cross one already there
+	vector<pair<int, int>> tubes;
+	auto pt = [&](int id)
+	{ return Point{(double)all[id].x, (double)all[id].y}; };
+	int known = 0;
+	for (int m = 0; m < months; ++m)
+	{
+		level.months[m].resources = 2000 * scale;
+		for (int u = 0; u < known; ++u)
+		{
+			if (rng.next(2))
+				continue;
+			int best = -1;
+			double best_d = 1e18;
+			for (int v = 0; v < u; ++v)
+			{
+				double d = dist_sq(pt(u), pt(v));
+				if (d > 0 && d < best_d)
+				{
+					best_d = d;
+					best = v;
+				}
+			}
+			if (best < 0)
+				continue;
+			bool ok = true;
+			for (auto [a, b] : tubes)
+			{
+				if ((a == u && b == best) || (a == best && b == u))
+				{
+					ok = false;
+					break;
+				}
+				if (a == u || a == best || b == u || b == best)
+					continue;
+				if (segments_intersect(pt(u), pt(best), pt(a), pt(b)))
+				{
+					ok = false;
+					break;
+				}
+			}
+			if (!ok)
+				continue;
+			tubes.push_back({best, u});
+			level.months[m].routes.push_back({best, u, 1});
+		}
+		known += level.months[m].buildings.size();
+	}
+	return level;
+}
+
+// ==========================================
+// REPLAY
+// ==========================================
+
+struct RunStats
+{
+	vector<double> turn_ms;
+	vector<double> turn_allocs;
+	double parse_ms = 0, solve_ms = 0, output_ms = 0;
+	long long allocs = 0;
+	int quiet_turns = 0, quiet_allocating = 0; // turns with no new buildings, and those that allocated
+	int over_budget = 0; // turns slower than the solver's own budget
+	uint64_t checksum = 1469598103934665603ULL; // FNV-1a over every action line
+	int actions = 0;
+	double phase_ms[PH_COUNT] = {};
+	long long counters[PC_COUNT] = {};
+};
+
+static double ms_since(chrono::steady_clock::time_point t)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - t).count();
+}
+
+// The referee's side of the game, as far as the turn input needs it: spends
+// resources on legal actions and remembers routes and pods
+struct Referee
+{
+	map<int, pair<int, int>> pos;
+	map<pair<int, int>, int> routes;
+	map<int, vector<int>> pods;
+	long long resources = 0;
+
+	int tube_cost(int u, int v)
+	{
+		auto [ax, ay] = pos[u];
+		auto [bx, by] = pos[v];
+		return max(1, (int)floor(sqrt((double)(ax - bx) * (ax - bx) + (double)(ay - by) * (ay - by)) * 10));
+	}
+
+	string turn_input(const Month &month)
+	{
+		resources += month.resources;
+		for (const auto &b : month.buildings)
+			pos[b.id] = {b.x, b.y};
+		for (auto [u, v, c] : month.routes)
+			routes[{min(u, v), max(u, v)}] = c;
+
+		string s;
+		s += to_string(resources) + "\n" + to_string(routes.size()) + "\n";
+		for (const auto &[e, c] : routes)
+			s += to_string(e.first) + " " + to_string(e.second) + " " + to_string(c) + "\n";
+		s += to_string(pods.size()) + "\n";
+		for (const auto &[id, path] : pods)
+		{
+			s += to_string(id) + " " + to_string(path.size());
+			for (int x : path)
+				s += " " + to_string(x);
+			s += "\n";
+		}
+		s += to_string(month.buildings.size()) + "\n";
+		for (const auto &b : month.buildings)
+		{
+			s += to_string(b.type) + " " + to_string(b.id) + " " + to_string(b.x) + " " + to_string(b.y);
+			if (b.type == 0)
+			{
+				s += " " + to_string(b.astronauts.size());
+				for (int t : b.astronauts)
+					s += " " + to_string(t);
+			}
+			s += "\n";
+		}
+		return s;
+	}
+
+	void apply(string_view line, int &count)
+	{
+		size_t at = 0;
+		while (at < line.size())
+		{
+			size_t end = line.find(';', at);
+			if (end == string_view::npos)
+				end = line.size();
+			istringstream act(string(line.substr(at, end - at)));
+			at = end + 1;
+
+			string verb;
+			if (!(act >> verb))
+				continue;
+			count++;
+			vector<int> args;
+			for (int x; act >> x;)
+				args.push_back(x);
+			if ((verb == "TUBE" || verb == "TELEPORT" || verb == "UPGRADE") && args.size() >= 2)
+			{
+				pair<int, int> e{min(args[0], args[1]), max(args[0], args[1])};
+				if (!pos.count(e.first) || !pos.count(e.second))
+					continue;
+				int cost = verb == "TELEPORT" ? 5000 : tube_cost(e.first, e.second);
+				if (resources < cost)
+					continue;
+				if (verb == "UPGRADE")
+				{
+					if (!routes.count(e) || routes[e] == 0)
+						continue;
+					routes[e]++;
+				}
+				else
+				{
+					if (routes.count(e))
+						continue;
+					routes[e] = verb == "TELEPORT" ? 0 : 1;
+				}
+				resources -= cost;
+			}
+			else if (verb == "POD" && args.size() >= 2 && resources >= 1000)
+			{
+				resources -= 1000;
+				pods[args[0]] = vector<int>(args.begin() + 1, args.end());
+			}
+		}
+	}
+};
+
+RunStats replay(const Level &level, int null_fd, string *record = nullptr)
+{
+	RunStats st;
+	Referee ref;
+	auto solver = make_unique<Solver>();
+	for (const Month &month : level.months)
+	{
+		string input = ref.turn_input(month);
+		if (record)
+			*record += input;
+		long long allocs_before = g_allocs.load();
+
+		auto t0 = chrono::steady_clock::now();
+		FastReader in(input.data(), input.size());
+		solver->read_turn(in);
+		double parse = ms_since(t0);
+
+		auto t1 = chrono::steady_clock::now();
+		solver->solve();
+		double solve = ms_since(t1);
+
+		auto t2 = chrono::steady_clock::now();
+		solver->actions.flush(null_fd);
+		double output = ms_since(t2);
+
+		long long allocs = g_allocs.load() - allocs_before;
+		st.allocs += allocs;
+		st.turn_allocs.push_back(allocs);
+		if (month.buildings.empty())
+		{
+			st.quiet_turns++;
+			st.quiet_allocating += allocs > 0;
+		}
+		st.parse_ms += parse;
+		st.solve_ms += solve;
+		st.output_ms += output;
+		double budget = st.turn_ms.empty() ? Solver::FIRST_TURN_BUDGET_MS : Solver::TURN_BUDGET_MS;
+		st.over_budget += parse + solve + output > budget;
+		st.turn_ms.push_back(parse + solve + output);
+
+		string_view line = solver->actions.line();
+		for (char c : line)
+		{
+			st.checksum ^= (unsigned char)c;
+			st.checksum *= 1099511628211ULL;
+		}
+		ref.apply(line, st.actions);
+
+#if ODC_PROFILE
+		for (int i = 0; i < PH_COUNT; ++i)
+			st.phase_ms[i] += g_profile.phase_ms[i];
+		for (int i = 0; i < PC_COUNT; ++i)
+			st.counters[i] += g_profile.counters[i].load();
+#endif
+	}
+	return st;
+}
+
+// ==========================================
+// REPORT
+// ==========================================
+
+using rt::percentile;
+
+// Returns false if a turn ran over the solver's budget, or a turn without
+// new buildings touched the heap (the solver reserves its room on the turns
+// that add them)
+bool report(const string &name, const vector<RunStats> &runs)
+{
+	vector<double> turns, turn_allocs;
+	double parse = 0, solve = 0, output = 0;
+	long long allocs = 0;
+	for (const auto &r : runs)
+	{
+		turns.insert(turns.end(), r.turn_ms.begin(), r.turn_ms.end());
+		turn_allocs.insert(turn_allocs.end(), r.turn_allocs.begin(), r.turn_allocs.end());
+		parse += r.parse_ms;
+		solve += r.solve_ms;
+		output += r.output_ms;
+		allocs += r.allocs;
+	}
+	int n = runs.size();
+	bool stable = true;
+	int quiet_allocating = 0, over_budget = 0;
+	for (const auto &r : runs)
+	{
+		stable &= r.checksum == runs[0].checksum;
+		quiet_allocating += r.quiet_allocating;
+		over_budget += r.over_budget;
+	}
+
+	printf("%-22s turns %4zu  p50 %8.3f  p99 %8.3f  max %8.3f ms | parse %8.3f  solve %9.3f  output %7.3f ms | allocs %8lld, per turn p50 %5.0f max %6.0f | actions %5d | %016llx%s\n",
+		   name.c_str(), turns.size() / max(n, 1),
+		   percentile(turns, 0.5), percentile(turns, 0.99), percentile(turns, 1.0),
+		   parse / n, solve / n, output / n, allocs / n,
+		   percentile(turn_allocs, 0.5), percentile(turn_allocs, 1.0), runs[0].actions,
+		   (unsigned long long)runs[0].checksum, stable ? "" : " (varies)");
+
+#if ODC_PROFILE
+	printf("%-22s", "");
+	for (int i = 0; i < PH_COUNT; ++i)
+	{
+		double t = 0;
+		for (const auto &r : runs)
+			t += r.phase_ms[i];
+		printf(" %s %.3f", Profile::PHASE_NAMES[i], t / n);
+	}
+	printf(" ms |");
+	for (int i = 0; i < PC_COUNT; ++i)
+	{
+		long long c = 0;
+		for (const auto &r : runs)
+			c += r.counters[i];
+		printf(" %s %lld", Profile::COUNTER_NAMES[i], c / n);
+	}
+	printf("\n");
+#endif
+	if (quiet_allocating > 0)
+		printf("%-22s ALLOCATED on %d of %d turns without new buildings\n", "", quiet_allocating, runs[0].quiet_turns * n);
+	if (over_budget > 0)
+		printf("%-22s OVER BUDGET on %d of %zu turns\n", "", over_budget, turns.size());
+	return quiet_allocating == 0 && over_budget == 0;
+}
+
+// ==========================================
+// TRANSCRIPTS
+// ==========================================
+
+// Solver behind the runtime's step() interface. Each step parses one turn
+// from where the transcript stands and answers it with one action line.
+struct OdcProgram
+{
+	unique_ptr<Solver> solver = make_unique<Solver>();
+	int null_fd;
+
+	bool step(rt::Reader &in, rt::Writer &out)
+	{
+		string_view rest = in.rest();
+		FastReader turn(rest.data(), rest.size());
+		if (!solver->read_turn(turn))
+			return false;
+		in.skip(turn.consumed());
+		solver->solve();
+		solver->actions.flush(null_fd);
+		out.append(solver->actions.line());
+		return true;
+	}
+};
+
+int run_transcripts(const vector<string> &files, int null_fd)
+{
+	for (const auto &f : files)
+	{
+		string text;
+		if (!rt::read_file(f.c_str(), text))
+		{
+			fprintf(stderr, "cannot read %s\n", f.c_str());
+			return 1;
+		}
+		OdcProgram program{make_unique<Solver>(), null_fd};
+		rt::Reader in(text.data(), text.size());
+		rt::drive(program, in).print(f.c_str());
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	vector<string> files;
+	int repeat = 1, scale = 0;
+	uint64_t seed = 1;
+	bool transcripts = false;
+	const char *record_path = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		string a = argv[i];
+		if (a == "--repeat" && i + 1 < argc)
+			repeat = max(1, atoi(argv[++i]));
+		else if (a == "--synthetic" && i + 1 < argc)
+			scale = max(1, atoi(argv[++i]));
+		else if (a == "--seed" && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (a == "--record" && i + 1 < argc)
+			record_path = argv[++i];
+		else if (a == "--transcript")
+			transcripts = true;
+		else
+			files.push_back(a);
+	}
+
+#if ODC_PROFILE
+	g_profile.quiet = true;
+#endif
+	int null_fd = open("/dev/null", O_WRONLY);
+	if (transcripts && !files.empty())
+		return run_transcripts(files, null_fd);
+
+	vector<Level> levels;
+	for (const auto &f : files)
+	{
+		Level level;
+		if (!load_level(f, level))
+		{
+			fprintf(stderr, "cannot read %s\n", f.c_str());
+			return 1;
+		}
+		levels.push_back(move(level));
+	}
+	if (scale > 0)
+		levels.push_back(synthetic_level(levels, scale, seed));
+	if (levels.empty())
+	{
+		fprintf(stderr, "usage: %s [--repeat N] [--synthetic SCALE] [--seed S] [--record FILE] level.txt...\n"
+						"       %s --transcript FILE...\n",
+				argv[0], argv[0]);
+		return 1;
+	}
+
+	string record;
+	bool quiet = true;
+	uint64_t all = 1469598103934665603ULL;
+	for (const auto &level : levels)
+	{
+		vector<RunStats> runs;
+		for (int r = 0; r < repeat; ++r)
+			runs.push_back(replay(level, null_fd, record_path && r == 0 ? &record : nullptr));
+		quiet &= report(level.name, runs);
+		all = (all ^ runs[0].checksum) * 1099511628211ULL;
+	}
+	printf("checksum %016llx\n", (unsigned long long)all);
+	close(null_fd);
+	if (record_path)
+	{
+		ofstream out(record_path, ios::binary);
+		out << record;
+		if (!out)
+		{
+			fprintf(stderr, "cannot write %s\n", record_path);
+			return 1;
+		}
+	}
+	return quiet ? 0 : 1;
+}
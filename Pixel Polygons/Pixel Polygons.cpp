@@ -2,69 +2,536 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <climits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PP_AVX2_DISPATCH 1
+#endif
 
 using namespace std;
 
-// looks more hardcoded, lol.
+// Row bands counted in parallel by calc_edges on big grids. 1 = one thread.
+#ifndef PP_THREADS
+#define PP_THREADS 1
+#endif
+
+// In-memory version: the grid is copied into one buffer of 0/1 bytes with
+// a border of empty cells on every side, so nothing needs a bounds test.
+// Buffer row r is grid row r - 1 and column c is grid column c - 1, so the
+// four cells around vertex (y, x) are buffer rows y, y + 1 at columns x,
+// x + 1. Every corner sits on a vertex, and the four cells around that vertex
+// decide it. One or three filled cells make one corner, two diagonal ones
+// make two (see calc_edges_streaming).
+struct PaddedGrid
+{
+	int n;
+	size_t stride; // whole vectors, and a spare one past the right border
+	vector<uint8_t> cells;
+
+	PaddedGrid(int n) : n(n), stride(((size_t)n + 2 + 31) / 32 * 32 + 32), cells((size_t)(n + 2) * stride, 0) {}
+
+	uint8_t *row(int r) { return cells.data() + (size_t)r * stride; }
+	const uint8_t *row(int r) const { return cells.data() + (size_t)r * stride; }
+
+	void fill_row(int y, const string &line)
+	{
+		uint8_t *out = row(y + 1) + 1;
+		const char *in = line.data();
+		int width = min<int>(n, line.size());
+		for (int x = 0; x < width; x++)
+			out[x] = in[x] == '#';
+	}
+};
+
+// Corners on vertices [0, count) between buffer rows `above` and `below`;
+// the fallback when there are no vector units
+[[maybe_unused]] static long long count_vertices_scalar(const uint8_t *above, const uint8_t *below, int count)
+{
+	long long corners = 0;
+	for (int x = 0; x < count; x++)
+	{
+		uint8_t tl = above[x], tr = above[x + 1], bl = below[x], br = below[x + 1];
+		uint8_t diagonal = (tl ^ tr) & (tl ^ bl) & ~(tl ^ br) & 1;
+		corners += (tl ^ tr ^ bl ^ br) + 2 * diagonal;
+	}
+	return corners;
+}
+
+#ifdef __SSE2__
+// 16 vertices per step. Reading past `count` is fine: the padding is zero
+// there and zero cells make no corners.
+static long long count_vertices_sse2(const uint8_t *above, const uint8_t *below, int count)
+{
+	const __m128i one = _mm_set1_epi8(1), zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	for (int x = 0; x < count; x += 16)
+	{
+		__m128i tl = _mm_loadu_si128((const __m128i *)(above + x)), tr = _mm_loadu_si128((const __m128i *)(above + x + 1));
+		__m128i bl = _mm_loadu_si128((const __m128i *)(below + x)), br = _mm_loadu_si128((const __m128i *)(below + x + 1));
+		__m128i odd = _mm_xor_si128(_mm_xor_si128(tl, tr), _mm_xor_si128(bl, br));
+		__m128i diagonal = _mm_andnot_si128(_mm_xor_si128(tl, br), _mm_and_si128(_mm_xor_si128(tl, tr), _mm_xor_si128(tl, bl)));
+		diagonal = _mm_and_si128(diagonal, one);
+		__m128i corners = _mm_add_epi8(odd, _mm_add_epi8(diagonal, diagonal));
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(corners, zero));
+	}
+	return _mm_cvtsi128_si64(sum) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum));
+}
+#endif
+
+#ifdef PP_AVX2_DISPATCH
+// Same as the SSE2 kernel, 32 vertices per step
+__attribute__((target("avx2"))) static long long count_vertices_avx2(const uint8_t *above, const uint8_t *below, int count)
+{
+	const __m256i one = _mm256_set1_epi8(1), zero = _mm256_setzero_si256();
+	__m256i sum = zero;
+	for (int x = 0; x < count; x += 32)
+	{
+		__m256i tl = _mm256_loadu_si256((const __m256i *)(above + x)), tr = _mm256_loadu_si256((const __m256i *)(above + x + 1));
+		__m256i bl = _mm256_loadu_si256((const __m256i *)(below + x)), br = _mm256_loadu_si256((const __m256i *)(below + x + 1));
+		__m256i odd = _mm256_xor_si256(_mm256_xor_si256(tl, tr), _mm256_xor_si256(bl, br));
+		__m256i diagonal = _mm256_andnot_si256(_mm256_xor_si256(tl, br), _mm256_and_si256(_mm256_xor_si256(tl, tr), _mm256_xor_si256(tl, bl)));
+		diagonal = _mm256_and_si256(diagonal, one);
+		__m256i corners = _mm256_add_epi8(odd, _mm256_add_epi8(diagonal, diagonal));
+		sum = _mm256_add_epi64(sum, _mm256_sad_epu8(corners, zero));
+	}
+	long long lanes[4];
+	_mm256_storeu_si256((__m256i *)lanes, sum);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+static bool cpu_has_avx2()
+{
+	static const bool ok = __builtin_cpu_supports("avx2");
+	return ok;
+}
+#endif
+
+// Vertex rows [y0, y1). Row y reads buffer rows y and y + 1, so a band's
+// last row reads one row of the next band; the buffer is read-only by then
+// and every vertex row belongs to exactly one band.
+static long long count_vertex_rows(const PaddedGrid &grid, int y0, int y1)
+{
+	long long corners = 0;
+	for (int y = y0; y < y1; y++)
+	{
+		const uint8_t *above = grid.row(y), *below = grid.row(y + 1);
+#if defined(PP_AVX2_DISPATCH)
+		if (cpu_has_avx2())
+		{
+			corners += count_vertices_avx2(above, below, grid.n + 1);
+			continue;
+		}
+#endif
+#ifdef __SSE2__
+		corners += count_vertices_sse2(above, below, grid.n + 1);
+#else
+		corners += count_vertices_scalar(above, below, grid.n + 1);
+#endif
+	}
+	return corners;
+}
+
+// Split [0, rows) into contiguous bands and run f(band, begin, end) on each,
+// on PP_THREADS threads once the grid is big enough to pay for them
+template <class F>
+static void run_bands(int rows, F f)
+{
+	int bands = PP_THREADS > 1 && rows >= 1024 ? PP_THREADS : 1;
+	vector<thread> workers;
+	for (int b = 1; b < bands; b++)
+		workers.emplace_back([=, &f]
+							 { f(b, (long long)rows * b / bands, (long long)rows * (b + 1) / bands); });
+	f(0, 0, rows / bands);
+	for (auto &t : workers)
+		t.join();
+}
 
-int calc_edges(string *table, const int n)
+long long calc_edges(string *table, const int n)
 {
-	int corners = 0;
+	PaddedGrid grid(n);
+	run_bands(n, [&](int, int y0, int y1)
+			  {
+				  for (int y = y0; y < y1; y++)
+					  grid.fill_row(y, table[y]); });
 
+	vector<long long> partial(max(1, PP_THREADS));
+	run_bands(n + 1, [&](int band, int y0, int y1)
+			  { partial[band] = count_vertex_rows(grid, y0, y1); });
+
+	long long corners = 0;
+	for (long long c : partial)
+		corners += c;
+	return corners;
+}
+
+// Streaming version: every corner sits on a grid vertex, and the 2x2 cells
+// around a vertex decide it on their own. One or three filled cells make one
+// corner, two diagonal ones make two, anything else none. So only the
+// previous and current rows are needed, each packed 64 cells to a word (bit
+// x = column x, everything outside the grid empty), and a whole word of
+// vertices is counted with a few bitwise ops and popcounts.
+
+typedef vector<uint64_t> BitRow;
+
+// Eight cells at a time: bytes equal to '#' become 0 after the xor, the
+// classic has-zero-byte trick flags them in each byte's top bit, and the
+// multiply gathers those eight flags into one byte
+static inline uint64_t pack8(const char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, 8);
+	v ^= 0x2323232323232323ULL;
+	uint64_t nonzero = ((v & 0x7f7f7f7f7f7f7f7fULL) + 0x7f7f7f7f7f7f7f7fULL) | v;
+	uint64_t hits = (~nonzero & 0x8080808080808080ULL) >> 7;
+	return (hits * 0x0102040810204080ULL) >> 56;
+}
+
+static void pack_row(const string &line, int n, BitRow &row)
+{
+	fill(row.begin(), row.end(), 0);
+	int width = min<int>(n, line.size());
+	int x = 0;
+	for (; x + 8 <= width; x += 8)
+		row[x >> 6] |= pack8(line.data() + x) << (x & 63);
+	for (; x < width; x++)
+		row[x >> 6] |= (uint64_t)(line[x] == '#') << (x & 63);
+}
+
+// Corners on the vertex row between `above` and `below`. Vertex x has cells
+// x - 1 and x on each side, so the left cells are the row shifted up a bit.
+static long long count_vertex_row(const BitRow &above, const BitRow &below)
+{
+	long long corners = 0;
+	uint64_t carry_above = 0, carry_below = 0;
+	for (size_t w = 0; w < above.size(); w++)
+	{
+		uint64_t tr = above[w], br = below[w];
+		uint64_t tl = (tr << 1) | carry_above, bl = (br << 1) | carry_below;
+		carry_above = tr >> 63;
+		carry_below = br >> 63;
+
+		uint64_t odd = tl ^ tr ^ bl ^ br;
+		uint64_t diagonal = (tl & br & ~tr & ~bl) | (tr & bl & ~tl & ~br);
+		corners += __builtin_popcountll(odd) + 2 * __builtin_popcountll(diagonal);
+	}
+	return corners;
+}
+
+// Reads the n rows from `in` one at a time; memory is two packed rows
+long long calc_edges_streaming(istream &in, const int n)
+{
+	// n + 1 vertices per row, so room for the shift out of the last cell
+	size_t words = (size_t)n / 64 + 1;
+	BitRow above(words, 0), below(words, 0);
+	string line;
+	long long corners = 0;
 	for (int y = 0; y < n; y++)
 	{
+		getline(in, line);
+		pack_row(line, n, below);
+		corners += count_vertex_row(above, below);
+		swap(above, below);
+	}
+	fill(below.begin(), below.end(), 0);
+	return corners + count_vertex_row(above, below);
+}
+
+// Per-polygon version: one streaming pass that labels 4-connected shapes
+// with a union-find over rows and tallies each one as it goes. Corners come
+// from the same vertex patterns as above, credited to the cell they belong
+// to (both cells of a diagonal pair get one). Labels are provisional until
+// the end: tallies are added at the current root and merged on every union.
+//
+// With outlines on, every corner is also kept with the two directions its
+// outline edges leave in (the quadrant of the odd cell out). On one vertex
+// row, a right-going corner joins the next left-going one; on one vertex
+// column, a down-going corner joins the next up-going one. So the loops
+// drop out of sorting the corners, with no second look at the grid.
+
+struct Polygon
+{
+	long long corners = 0; // also the number of outline edges
+	long long area = 0;
+	long long perimeter = 0;
+	int min_x = INT_MAX, min_y = INT_MAX, max_x = -1, max_y = -1;
+	vector<vector<pair<int, int>>> outlines; // vertex loops (x, y), outer boundary and holes alike
+
+	void merge(const Polygon &o)
+	{
+		corners += o.corners;
+		area += o.area;
+		perimeter += o.perimeter;
+		min_x = min(min_x, o.min_x);
+		min_y = min(min_y, o.min_y);
+		max_x = max(max_x, o.max_x);
+		max_y = max(max_y, o.max_y);
+	}
+};
+
+class PolygonLabeller
+{
+public:
+	PolygonLabeller(int n, bool keep_outlines)
+		: n(n), keep_outlines(keep_outlines), above(n + 2, -1), below(n + 2, -1) {}
+
+	void add_row(const string &line)
+	{
+		// Labels for this row; index x + 1 is column x, the ends stay empty
+		const char *in = line.data();
+		int width = min<int>(n, line.size());
 		for (int x = 0; x < n; x++)
 		{
-			if (table[y][x] != '#')
+			int up = above[x + 1], left = below[x];
+			if (x >= width || in[x] != '#')
+			{
+				below[x + 1] = -1;
 				continue;
+			}
+
+			int label;
+			if (up < 0 && left < 0)
+			{
+				label = parent.size();
+				parent.push_back(label);
+				tally.emplace_back();
+			}
+			else if (up >= 0 && left >= 0)
+				label = unite(up, left);
+			else
+				label = up >= 0 ? up : left;
+			below[x + 1] = label;
 
-			bool up = (table[y - 1][x] == '#');
-			bool down = (table[y + 1][x] == '#');
-			bool left = (table[y][x - 1] == '#');
-			bool right = (table[y][x + 1] == '#');
-
-			bool upLeft = (table[y - 1][x - 1] == '#');
-			bool upRight = (table[y - 1][x + 1] == '#');
-			bool downLeft = (x > 0 && table[y + 1][x - 1] == '#');
-			bool downRight = (table[y + 1][x + 1] == '#');
-
-			if (!up && !left)
-				corners++;
-			if (!up && !right)
-				corners++;
-			if (!down && !left)
-				corners++;
-			if (!down && !right)
-				corners++;
-
-			if (up && left && !upLeft)
-				corners++;
-			if (up && right && !upRight)
-				corners++;
-			if (down && left && !downLeft)
-				corners++;
-			if (down && right && !downRight)
-				corners++;
+			Polygon &t = tally[find(label)];
+			t.area++;
+			t.perimeter += 4 - 2 * (up >= 0) - 2 * (left >= 0);
+			t.min_x = min(t.min_x, x);
+			t.max_x = max(t.max_x, x);
+			t.min_y = min(t.min_y, y);
+			t.max_y = max(t.max_y, y);
 		}
+		vertex_row();
+		swap(above, below);
+		y++;
 	}
 
-	return corners;
+	vector<Polygon> finish()
+	{
+		fill(below.begin(), below.end(), -1);
+		vertex_row();
+
+		// Roots in label order, which is order of first cell in the scan
+		vector<int> index(parent.size(), -1);
+		vector<Polygon> polygons;
+		for (size_t l = 0; l < parent.size(); l++)
+			if (find(l) == (int)l)
+			{
+				index[l] = polygons.size();
+				polygons.push_back(tally[l]);
+			}
+
+		if (keep_outlines)
+		{
+			// Counting sort of the corners by polygon, then one span each
+			vector<size_t> start(polygons.size() + 1, 0);
+			for (Corner &c : corners)
+			{
+				c.label = index[find(c.label)];
+				start[c.label + 1]++;
+			}
+			for (size_t i = 0; i < polygons.size(); i++)
+				start[i + 1] += start[i];
+			vector<Corner> sorted(corners.size());
+			vector<size_t> at(start.begin(), start.end() - 1);
+			for (const Corner &c : corners)
+				sorted[at[c.label]++] = c;
+			corners.clear();
+			corners.shrink_to_fit();
+
+			TraceScratch scratch;
+			for (size_t i = 0; i < polygons.size(); i++)
+				trace(sorted.data() + start[i], start[i + 1] - start[i], scratch, polygons[i].outlines);
+		}
+		return polygons;
+	}
+
+private:
+	struct Corner
+	{
+		int label;
+		int x, y;
+		bool left, up; // directions of its horizontal and vertical edges
+	};
+
+	int n, y = 0;
+	bool keep_outlines;
+	vector<int> above, below; // labels of the previous and current row, -1 = empty
+	vector<int> parent;
+	vector<Polygon> tally; // per label, valid at roots
+	vector<Corner> corners;
+
+	int find(int a)
+	{
+		while (parent[a] != a)
+			a = parent[a] = parent[parent[a]];
+		return a;
+	}
+
+	// Keeps the older root so labels stay in scan order
+	int unite(int a, int b)
+	{
+		a = find(a);
+		b = find(b);
+		if (a == b)
+			return a;
+		if (b < a)
+			swap(a, b);
+		parent[b] = a;
+		tally[a].merge(tally[b]);
+		return a;
+	}
+
+	void corner(int label, int x, bool left, bool up)
+	{
+		tally[find(label)].corners++;
+		if (keep_outlines)
+			corners.push_back({label, x, y, left, up});
+	}
+
+	// Vertex row y, between grid rows y - 1 (above) and y (below); vertex x
+	// has columns x - 1 and x on either side
+	void vertex_row()
+	{
+		for (int x = 0; x <= n; x++)
+		{
+			int tl = above[x], tr = above[x + 1], bl = below[x], br = below[x + 1];
+			int filled = (tl >= 0) + (tr >= 0) + (bl >= 0) + (br >= 0);
+			if (filled == 1 || filled == 3)
+			{
+				// The odd cell out points along both edges
+				bool odd_tl = (tl >= 0) == (filled == 1), odd_tr = (tr >= 0) == (filled == 1);
+				bool odd_bl = (bl >= 0) == (filled == 1);
+				int label = max(max(tl, tr), max(bl, br));
+				corner(label, x, odd_tl || odd_bl, odd_tl || odd_tr);
+			}
+			else if (filled == 2 && tl >= 0 && br >= 0)
+			{
+				corner(tl, x, true, true);
+				corner(br, x, false, false);
+			}
+			else if (filled == 2 && tr >= 0 && bl >= 0)
+			{
+				corner(tr, x, false, true);
+				corner(bl, x, true, false);
+			}
+		}
+	}
+
+	struct TraceScratch
+	{
+		vector<int> order, across, along;
+		vector<bool> seen;
+	};
+
+	static void trace(const Corner *cs, int m, TraceScratch &scratch, vector<vector<pair<int, int>>> &loops)
+	{
+		vector<int> &order = scratch.order, &across = scratch.across, &along = scratch.along;
+		order.resize(m);
+		across.resize(m);
+		along.resize(m);
+		for (int i = 0; i < m; i++)
+			order[i] = i;
+
+		// Along a vertex row: right-going then left-going, left first on a tie
+		sort(order.begin(), order.end(), [&](int a, int b)
+			 { return make_tuple(cs[a].y, cs[a].x, !cs[a].left) < make_tuple(cs[b].y, cs[b].x, !cs[b].left); });
+		for (int i = 0; i + 1 < m; i += 2)
+		{
+			across[order[i]] = order[i + 1];
+			across[order[i + 1]] = order[i];
+		}
+		// Down a vertex column: down-going then up-going, up first on a tie
+		sort(order.begin(), order.end(), [&](int a, int b)
+			 { return make_tuple(cs[a].x, cs[a].y, !cs[a].up) < make_tuple(cs[b].x, cs[b].y, !cs[b].up); });
+		for (int i = 0; i + 1 < m; i += 2)
+		{
+			along[order[i]] = order[i + 1];
+			along[order[i + 1]] = order[i];
+		}
+
+		vector<bool> &seen = scratch.seen;
+		seen.assign(m, false);
+		for (int start = 0; start < m; start++)
+		{
+			if (seen[start])
+				continue;
+			vector<pair<int, int>> loop;
+			int i = start;
+			do
+			{
+				int j = across[i];
+				seen[i] = seen[j] = true;
+				loop.push_back({cs[i].x, cs[i].y});
+				loop.push_back({cs[j].x, cs[j].y});
+				i = along[j];
+			} while (i != start);
+			loops.push_back(move(loop));
+		}
+	}
+};
+
+vector<Polygon> label_polygons(istream &in, const int n, bool outlines)
+{
+	PolygonLabeller labeller(n, outlines);
+	string line;
+	for (int y = 0; y < n; y++)
+	{
+		getline(in, line);
+		labeller.add_row(line);
+	}
+	return labeller.finish();
 }
 
-int main()
+// The puzzle's answer is the total. --polygons lists every shape instead,
+// --outlines with its vertex loops too. Harnesses build with PP_NO_MAIN.
+#ifndef PP_NO_MAIN
+int main(int argc, char **argv)
 {
+	bool polygons = false, outlines = false;
+	for (int i = 1; i < argc; i++)
+	{
+		outlines |= string(argv[i]) == "--outlines";
+		polygons |= outlines || string(argv[i]) == "--polygons";
+	}
+
 	int n;
+	ios::sync_with_stdio(false);
 	cin >> n;
 	cin.ignore();
 	cerr << n << endl;
-	string table[n];
-	for (int i = 0; i < n; i++)
+
+	if (!polygons)
 	{
-		string line;
-		getline(cin, line);
-		table[i] = line;
-		cerr << line << endl;
+		cout << calc_edges_streaming(cin, n) << endl;
+		return 0;
 	}
 
-	cout << calc_edges(table, n) << endl;
+	vector<Polygon> shapes = label_polygons(cin, n, outlines);
+	cout << shapes.size() << " polygons" << endl;
+	for (const Polygon &p : shapes)
+	{
+		cout << "corners " << p.corners << " area " << p.area << " perimeter " << p.perimeter
+			 << " box " << p.min_x << "," << p.min_y << " " << p.max_x << "," << p.max_y << endl;
+		for (const auto &loop : p.outlines)
+		{
+			cout << " ";
+			for (auto [x, y] : loop)
+				cout << " " << x << "," << y;
+			cout << endl;
+		}
+	}
 }
+#endif
@@ -0,0 +1,168 @@
+// Benchmark for Pixel Polygons.cpp: steps the three ways of counting corners
+// (in-memory, streaming, polygon labelling) over the same puzzles through the
+// shared runtime (common/runtime.h) and reports per-puzzle latency.
+//
+//   g++ -O2 -std=c++17 -o bench bench.cpp
+//   ./bench puzzles.txt
+//   ./bench --random 20 --size 2000 --seed 1
+//
+// A puzzle file holds any number of puzzles back to back, each as the game's
+// stdin: n, then n rows of '#' and '.'. Every mode prints the total corner
+// count per puzzle, so the three checksums match when the modes agree.
+
+#define PP_NO_MAIN
+#include "Pixel Polygons.cpp"
+#include "../common/runtime.h"
+
+#include <sstream>
+#include <cstdlib>
+
+// ==========================================
+// PROGRAMS
+// ==========================================
+
+enum Mode
+{
+	MODE_MEMORY,
+	MODE_STREAMING,
+	MODE_LABEL,
+	MODE_COUNT
+};
+
+static const char *MODE_NAMES[MODE_COUNT] = {"memory", "streaming", "label"};
+
+// One puzzle per step: n and its rows in, the total out
+struct CornerProgram
+{
+	Mode mode;
+	vector<string> table;
+
+	bool step(rt::Reader &in, rt::Writer &out)
+	{
+		int n;
+		string_view line;
+		if (!in.read_int(n))
+			return false;
+		in.read_line(line); // rest of the n line
+
+		long long corners = 0;
+		if (mode == MODE_MEMORY)
+		{
+			table.resize(n);
+			for (int y = 0; y < n; y++)
+			{
+				in.read_line(line);
+				table[y].assign(line.data(), line.size());
+			}
+			corners = calc_edges(table.data(), n);
+		}
+		else
+		{
+			// The other two read an istream, as they do from cin
+			const char *start = in.rest().data();
+			for (int y = 0; y < n; y++)
+				in.read_line(line);
+			istringstream rows(string(start, in.rest().data() - start));
+			if (mode == MODE_STREAMING)
+				corners = calc_edges_streaming(rows, n);
+			else
+				for (const Polygon &p : label_polygons(rows, n, false))
+					corners += p.corners;
+		}
+		out.append(corners).put('\n');
+		return true;
+	}
+};
+
+// ==========================================
+// PUZZLES
+// ==========================================
+
+static uint64_t rng_next(uint64_t &state)
+{
+	// xorshift64
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+// Overlapping random rectangles, so shapes merge into polygons with holes
+static void random_puzzle(uint64_t &state, int n, string &text)
+{
+	vector<string> rows(n, string(n, '.'));
+	int rects = max(1, n * n / 400);
+	for (int r = 0; r < rects; r++)
+	{
+		int w = 1 + rng_next(state) % 24, h = 1 + rng_next(state) % 24;
+		int x0 = rng_next(state) % n, y0 = rng_next(state) % n;
+		char c = rng_next(state) % 4 ? '#' : '.';
+		for (int y = y0; y < min(n, y0 + h); y++)
+			fill(rows[y].begin() + x0, rows[y].begin() + min(n, x0 + w), c);
+	}
+	text += to_string(n) + "\n";
+	for (const string &row : rows)
+		text += row + "\n";
+}
+
+int main(int argc, char **argv)
+{
+	vector<string> files;
+	int count = 0, size = 1000;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		string a = argv[i];
+		if (a == "--random" && i + 1 < argc)
+			count = max(1, atoi(argv[++i]));
+		else if (a == "--size" && i + 1 < argc)
+			size = max(1, atoi(argv[++i]));
+		else if (a == "--seed" && i + 1 < argc)
+			seed = max<uint64_t>(1, strtoull(argv[++i], nullptr, 10));
+		else
+			files.push_back(a);
+	}
+
+	vector<pair<string, string>> inputs; // name, text
+	for (const string &f : files)
+	{
+		string text;
+		if (!rt::read_file(f.c_str(), text))
+		{
+			fprintf(stderr, "cannot read %s\n", f.c_str());
+			return 1;
+		}
+		inputs.push_back({f, move(text)});
+	}
+	if (count > 0)
+	{
+		string text;
+		for (int i = 0; i < count; i++)
+			random_puzzle(seed, size, text);
+		inputs.push_back({"random " + to_string(count) + "x" + to_string(size), move(text)});
+	}
+	if (inputs.empty())
+	{
+		fprintf(stderr, "usage: %s [--random COUNT] [--size N] [--seed S] puzzles.txt...\n", argv[0]);
+		return 1;
+	}
+
+	bool agree = true;
+	for (const auto &[name, text] : inputs)
+	{
+		printf("%s\n", name.c_str());
+		uint64_t first = 0;
+		for (int m = 0; m < MODE_COUNT; m++)
+		{
+			CornerProgram program{(Mode)m, {}};
+			rt::Reader in(text.data(), text.size());
+			rt::StepStats st = rt::drive(program, in);
+			st.print(MODE_NAMES[m]);
+			if (m == 0)
+				first = st.checksum;
+			agree &= st.checksum == first;
+		}
+	}
+	printf(agree ? "all modes agree\n" : "MODES DISAGREE\n");
+	return agree ? 0 : 1;
+}
@@ -0,0 +1,503 @@
+// Shared runtime for the local tools around the bots in this repo: a chunked
+// input reader, a batched output writer, a turn timer with deadlines, a bump
+// arena, scoped profiler counters, and one step() interface through which a
+// harness drives any bot in-process.
+//
+// CodinGame takes a single source file per bot, so the bots do not include
+// this header; each keeps an inlined copy of what it needs (ODC's
+// FastReader, ActionWriter, TurnTimer, TurnArena and Profile are the same
+// designs). Harnesses include it next to the bot they drive and wrap the bot
+// in a small program adapter:
+//
+//   struct Program
+//   {
+//       // Read one turn from `in`, write the bot's answer to `out`;
+//       // false once the input is exhausted
+//       bool step(rt::Reader &in, rt::Writer &out);
+//   };
+//
+// rt::drive() then runs a program over a recorded input and measures each
+// step.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+namespace rt
+{
+
+// ==========================================
+// INPUT
+// ==========================================
+
+// Whitespace-separated integers, doubles and tokens, pulled in 64 KiB chunks
+// from a file descriptor, or read in place from memory. Nothing allocates.
+class Reader
+{
+public:
+	explicit Reader(int fd = 0) : fd(fd), buf(chunk), cap(BUF_SIZE) {}
+	Reader(const char *data, size_t n) : fd(-1), buf(data), len(n), cap(n) {}
+
+	bool read_long(long long &out)
+	{
+		if (!skip_space())
+			return false;
+		bool neg = false;
+		if (buf[pos] == '-' || buf[pos] == '+')
+			neg = buf[pos++] == '-';
+		long long v = 0;
+		for (int c = peek(); c >= '0' && c <= '9'; c = peek())
+		{
+			v = v * 10 + (c - '0');
+			pos++;
+		}
+		out = neg ? -v : v;
+		return true;
+	}
+
+	bool read_int(int &out)
+	{
+		long long v;
+		if (!read_long(v))
+			return false;
+		out = (int)v;
+		return true;
+	}
+
+	bool read_double(double &out)
+	{
+		if (!skip_space())
+			return false;
+		bool neg = false;
+		if (buf[pos] == '-' || buf[pos] == '+')
+			neg = buf[pos++] == '-';
+		double v = 0;
+		int c = peek();
+		for (; c >= '0' && c <= '9'; c = peek())
+		{
+			v = v * 10 + (c - '0');
+			pos++;
+		}
+		if (c == '.')
+		{
+			pos++;
+			double scale = 0.1;
+			for (c = peek(); c >= '0' && c <= '9'; c = peek())
+			{
+				v += (c - '0') * scale;
+				scale *= 0.1;
+				pos++;
+			}
+		}
+		if (c == 'e' || c == 'E')
+		{
+			pos++;
+			int e = 0;
+			read_int(e);
+			v *= std::pow(10.0, e);
+		}
+		out = neg ? -v : v;
+		return true;
+	}
+
+	// Rest of the current line without its newline. The view stays valid
+	// until the next read; from a descriptor a line must fit in one chunk.
+	bool read_line(std::string_view &out)
+	{
+		if (peek() < 0)
+			return false;
+		size_t start = pos;
+		for (;;)
+		{
+			while (pos < len && buf[pos] != '\n')
+				pos++;
+			// Line runs past what is buffered: move it down and read more
+			if (pos < len || fd < 0 || (start == 0 && len == cap))
+				break;
+			std::memmove(chunk, chunk + start, len - start);
+			len -= start;
+			pos = len;
+			start = 0;
+			if (!read_more())
+				break;
+		}
+		out = std::string_view(buf + start, pos - start);
+		if (!out.empty() && out.back() == '\r')
+			out.remove_suffix(1);
+		if (pos < len)
+			pos++;
+		return true;
+	}
+
+	// In-memory readers only: what is left, and a way to skip past input
+	// another parser consumed
+	std::string_view rest() const { return std::string_view(buf + pos, len - pos); }
+	void skip(size_t n) { pos = std::min(len, pos + n); }
+
+private:
+	static constexpr size_t BUF_SIZE = 1 << 16;
+	int fd;
+	char chunk[BUF_SIZE];
+	const char *buf;
+	size_t pos = 0, len = 0, cap;
+
+	bool refill()
+	{
+		if (fd < 0)
+			return false;
+		ssize_t n;
+		do
+			n = read(fd, chunk, BUF_SIZE);
+		while (n < 0 && errno == EINTR);
+		if (n <= 0)
+			return false;
+		pos = 0;
+		len = n;
+		return true;
+	}
+
+	bool read_more()
+	{
+		ssize_t n;
+		do
+			n = read(fd, chunk + len, cap - len);
+		while (n < 0 && errno == EINTR);
+		if (n <= 0)
+			return false;
+		len += n;
+		return true;
+	}
+
+	int peek()
+	{
+		if (pos == len && !refill())
+			return -1;
+		return (unsigned char)buf[pos];
+	}
+
+	bool skip_space()
+	{
+		for (int c = peek(); c >= 0; c = peek())
+		{
+			if (c > ' ')
+				return true;
+			pos++;
+		}
+		return false;
+	}
+};
+
+// ==========================================
+// OUTPUT
+// ==========================================
+
+// Output formatted into one reusable buffer (capacity survives across turns)
+// and sent with one write(2) per flush
+class Writer
+{
+public:
+	void clear() { len = 0; }
+	std::string_view view() const { return std::string_view(buf.data(), len); }
+
+	Writer &put(char c)
+	{
+		reserve(1);
+		buf[len++] = c;
+		return *this;
+	}
+
+	Writer &append(std::string_view s)
+	{
+		reserve(s.size());
+		std::memcpy(buf.data() + len, s.data(), s.size());
+		len += s.size();
+		return *this;
+	}
+
+	Writer &append(long long v)
+	{
+		char tmp[24];
+		int n = 0;
+		unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+		do
+			tmp[n++] = (char)('0' + u % 10);
+		while (u /= 10);
+		reserve(n + 1);
+		if (v < 0)
+			buf[len++] = '-';
+		while (n > 0)
+			buf[len++] = tmp[--n];
+		return *this;
+	}
+
+	// Everything buffered goes out, then the buffer is empty
+	bool flush(int fd = 1)
+	{
+		size_t done = 0;
+		while (done < len)
+		{
+			ssize_t n = write(fd, buf.data() + done, len - done);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				return false;
+			done += n;
+		}
+		len = 0;
+		return true;
+	}
+
+private:
+	std::vector<char> buf = std::vector<char>(4096);
+	size_t len = 0;
+
+	void reserve(size_t n)
+	{
+		if (len + n > buf.size())
+			buf.resize(std::max(buf.size() * 2, len + n));
+	}
+};
+
+// ==========================================
+// TIMING
+// ==========================================
+
+// Monotonic turn clock. The first turn usually has its own, larger budget.
+struct TurnTimer
+{
+	typedef std::chrono::steady_clock clock;
+	clock::time_point start_time = clock::now();
+	double budget_ms = 0;
+	double first_budget_ms, turn_budget_ms;
+	int turns = 0;
+
+	explicit TurnTimer(double turn_budget_ms = 0, double first_budget_ms = -1)
+		: first_budget_ms(first_budget_ms < 0 ? turn_budget_ms : first_budget_ms), turn_budget_ms(turn_budget_ms) {}
+
+	void start_turn()
+	{
+		start_time = clock::now();
+		budget_ms = turns++ == 0 ? first_budget_ms : turn_budget_ms;
+	}
+
+	double elapsed_ms() const
+	{
+		return std::chrono::duration<double, std::milli>(clock::now() - start_time).count();
+	}
+
+	double remaining_ms() const { return budget_ms - elapsed_ms(); }
+
+	// Deadline checks: past a fraction of the budget, or within margin_ms of it
+	bool past(double fraction) const { return elapsed_ms() >= budget_ms * fraction; }
+	bool expired(double margin_ms = 0) const { return remaining_ms() <= margin_ms; }
+};
+
+// ==========================================
+// ARENA
+// ==========================================
+
+// Bump allocator for per-turn scratch. reset() invalidates everything handed
+// out and folds the blocks into one big enough for the whole turn, so a
+// steady state makes no heap calls.
+class Arena
+{
+public:
+	Arena() = default;
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	~Arena()
+	{
+		for (auto &b : blocks)
+			::operator delete(b.data);
+	}
+
+	void *allocate(size_t n, size_t align = alignof(std::max_align_t))
+	{
+		size_t at = (used + align - 1) & ~(align - 1);
+		if (blocks.empty() || at + n > blocks.back().size)
+		{
+			add_block(std::max(n + align, blocks.empty() ? FIRST_BLOCK : 2 * blocks.back().size));
+			at = 0;
+		}
+		used = at + n;
+		return blocks.back().data + at;
+	}
+
+	template <class T>
+	T *make_array(size_t n)
+	{
+		T *p = static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+		for (size_t i = 0; i < n; ++i)
+			new (p + i) T();
+		return p;
+	}
+
+	void reset()
+	{
+		if (blocks.size() > 1)
+		{
+			size_t total = 0;
+			for (auto &b : blocks)
+			{
+				total += b.size;
+				::operator delete(b.data);
+			}
+			blocks.clear();
+			add_block(total);
+		}
+		used = 0;
+	}
+
+private:
+	static constexpr size_t FIRST_BLOCK = 1 << 16;
+
+	struct Block
+	{
+		char *data;
+		size_t size;
+	};
+	std::vector<Block> blocks;
+	size_t used = 0;
+
+	void add_block(size_t size)
+	{
+		blocks.push_back({static_cast<char *>(::operator new(size)), size});
+	}
+};
+
+// ==========================================
+// PROFILER
+// ==========================================
+
+// Named phase timers and event counters, indexed by small ints the caller
+// defines. Reports go to stderr.
+template <int PHASES, int COUNTERS>
+struct Profiler
+{
+	const char *phase_names[PHASES] = {};
+	const char *counter_names[COUNTERS] = {};
+	double phase_ms[PHASES] = {};
+	long long counters[COUNTERS] = {};
+
+	void reset()
+	{
+		std::fill(phase_ms, phase_ms + PHASES, 0.0);
+		std::fill(counters, counters + COUNTERS, 0LL);
+	}
+
+	void count(int counter, long long n = 1) { counters[counter] += n; }
+
+	void print(const char *label) const
+	{
+		std::fprintf(stderr, "%s:", label);
+		for (int i = 0; i < PHASES; ++i)
+			std::fprintf(stderr, " %s %.3f", phase_names[i] ? phase_names[i] : "?", phase_ms[i]);
+		std::fprintf(stderr, " ms |");
+		for (int i = 0; i < COUNTERS; ++i)
+			std::fprintf(stderr, " %s %lld", counter_names[i] ? counter_names[i] : "?", counters[i]);
+		std::fprintf(stderr, "\n");
+	}
+};
+
+// Adds the scope's wall time to a phase slot
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(double &slot) : slot(slot), start(std::chrono::steady_clock::now()) {}
+	~ScopedTimer()
+	{
+		slot += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	ScopedTimer(const ScopedTimer &) = delete;
+	ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+	double &slot;
+	std::chrono::steady_clock::time_point start;
+};
+
+// ==========================================
+// STEP DRIVER
+// ==========================================
+
+// Nearest-rank percentile; v is sorted in place
+inline double percentile(std::vector<double> &v, double q)
+{
+	if (v.empty())
+		return 0;
+	std::sort(v.begin(), v.end());
+	size_t rank = (size_t)std::ceil(q * v.size());
+	return v[std::min(v.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+struct StepStats
+{
+	std::vector<double> step_ms;
+	uint64_t checksum = 1469598103934665603ULL; // FNV-1a over all output
+
+	void print(const char *name)
+	{
+		std::vector<double> v = step_ms;
+		double total = 0;
+		for (double t : v)
+			total += t;
+		std::printf("%-14s steps %6zu  p50 %8.3f  p99 %8.3f  max %8.3f  total %9.1f ms | %016llx\n", name, v.size(),
+					percentile(v, 0.5), percentile(v, 0.99), percentile(v, 1.0), total, (unsigned long long)checksum);
+	}
+};
+
+// Step a program over the whole input, timing each step. If sink >= 0 the
+// output is written there, one flush per step, as the game would see it.
+template <class Program>
+StepStats drive(Program &program, Reader &in, int sink = -1)
+{
+	StepStats st;
+	Writer out;
+	TurnTimer timer;
+	for (;;)
+	{
+		out.clear();
+		timer.start_turn();
+		if (!program.step(in, out))
+			break;
+		st.step_ms.push_back(timer.elapsed_ms());
+		for (char c : out.view())
+		{
+			st.checksum ^= (unsigned char)c;
+			st.checksum *= 1099511628211ULL;
+		}
+		if (sink >= 0)
+			out.flush(sink);
+	}
+	return st;
+}
+
+// Whole file in memory, for an in-memory Reader
+inline bool read_file(const char *path, std::string &out)
+{
+	FILE *f = std::fopen(path, "rb");
+	if (!f)
+		return false;
+	char chunk[1 << 16];
+	size_t n;
+	out.clear();
+	while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0)
+		out.append(chunk, n);
+	std::fclose(f);
+	return true;
+}
+
+} // namespace rt